@@ -8,6 +8,8 @@
 #include <string>
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Function.h"
+#include "Options.h"
+#include "Source.h"
 
 using namespace std;
 using namespace llvm;
@@ -15,20 +17,41 @@ using namespace llvm;
 class BaseAST;
 class StmtAST;
 class ExprAST;
+class VarDeclAST;
+class ParamAST;
 
 typedef vector<unique_ptr<StmtAST>> StmtList;
+typedef vector<unique_ptr<ExprAST>> ExprList;
+typedef vector<unique_ptr<VarDeclAST>> FieldList;
+typedef vector<unique_ptr<ParamAST>> ParamList;
+// 数组每一维的 (下界, 上界)
+typedef vector<pair<int, int>> BoundList;
+
+// 当前正在生成的 Module, 由 CompUnitAST::codeGen 创建
+Module* getModule();
+// 交出 Module 与它所属的 LLVMContext (JIT 执行时由 ORC 接管), 之后不能再生成代码
+pair<unique_ptr<LLVMContext>, unique_ptr<Module>> takeModule();
+Value* logError(const char *str);
+// 代码生成中的错误, 带上出错节点的行号和列号; 同一语句只报告第一个错误
+Value* logError(const char *str, SourceRange range);
+// 错误信息 (logError, 语法错误) 写到这里, 默认是 cout; --batch 时指向每个文件各自的缓冲
+extern thread_local ostream* diagnostics;
 
 class BaseAST {
 protected:
     const char *midPREFIX = "├─ ";
     const char *endPREFIX = "└─ ";
 public:
+    // 节点在源文件中的范围
+    SourceRange range;
+
     virtual ~BaseAST() = default;
     virtual string getTypeName() const = 0;
     // 判断先判isLast再判else
     virtual void dump(string prefix, bool isLast) const = 0;
     void codeGenDump() {
-        cout << "starting " << this->getTypeName() << " codeGen" << endl;
+        if (options.dumpAST)
+            cout << "starting " << this->getTypeName() << " codeGen" << endl;
     }
     virtual Value* codeGen() = 0;
 };
@@ -38,7 +61,10 @@ protected:
     const char *colSTART = "\033[38;5;126m";
     const char *colEND = "\033[0m";
 public:
-    unique_ptr<BaseAST> def;
+    // TYPE, FUNCTION, PROCEDURE 以及顶层语句, 按源码顺序
+    vector<unique_ptr<BaseAST>> defs;
+    // 解析得到的源文件, 用于把节点的偏移换算成行号
+    unique_ptr<SourceFile> source;
 
     string getTypeName() const override {
         return "CompUnit";
@@ -47,9 +73,33 @@ public:
     void dump(string prefix, bool isLast) const override {
         // dump with color
         cout << prefix << this->colSTART << getTypeName() << this->colEND << endl;
-        def->dump(prefix, 1);
+        for (auto def = defs.begin(); def != defs.end(); def++) {
+            (*def)->dump(prefix, def == defs.end() - 1);
+        }
+    }
+
+    Value* codeGen() override;
+};
+
+class ParamAST : public BaseAST {
+protected:
+    const char *colSTART = "\033[38;5;51m";
+    const char *colEND = "\033[0m";
+public:
+    string ident;
+    string type;
+    // BYREF 按指针传递, 否则 (BYVAL) 按值传递
+    bool byRef = false;
+
+    string getTypeName() const override {
+        return "Param";
     }
 
+    void dump(string prefix, bool isLast) const override {
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << (byRef ? " BYREF " : " ") << ident << ": " << type << this->colEND << endl;
+    }
+
+    // 在函数入口声明同名局部变量, BYREF 参数不需要
     Value* codeGen() override;
 };
 
@@ -61,6 +111,7 @@ protected:
 public:
     string ident;
     string type;
+    unique_ptr<ParamList> params = make_unique<ParamList>();
     unique_ptr<BaseAST> block;
 
     string getTypeName() const override {
@@ -68,15 +119,16 @@ public:
     }
 
     void dump(string prefix, bool isLast) const override {
-        if (isLast) {
-            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << ident << type << this->colEND << endl;
-            block->dump(prefix + "   ", 1);
-        } else {
-            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << ident << type << this->colEND << endl;
-            block->dump(prefix + "│  ", 1); 
+        string childPrefix = prefix + (isLast ? "   " : "│  ");
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << " " << ident << " RETURNS " << type << this->colEND << endl;
+        for (auto &param: *params) {
+            param->dump(childPrefix, 0);
         }
+        block->dump(childPrefix, 1);
     }
 
+    // 先为所有 FUNCTION/PROCEDURE 生成声明, 调用可以出现在定义之前
+    Function* codeGenProto();
     Function* codeGen() override;
 };
 
@@ -87,6 +139,7 @@ protected:
     const char *colEND = "\033[0m";
 public:
     string ident;
+    unique_ptr<ParamList> params = make_unique<ParamList>();
     unique_ptr<BaseAST> block;
 
     string getTypeName() const override {
@@ -94,10 +147,15 @@ public:
     }
 
     void dump(string prefix, bool isLast) const override {
-        cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << ident << this->colEND << endl;
-        block->dump(prefix + "   ", 0);
+        string childPrefix = prefix + (isLast ? "   " : "│  ");
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << " " << ident << this->colEND << endl;
+        for (auto &param: *params) {
+            param->dump(childPrefix, 0);
+        }
+        block->dump(childPrefix, 1);
     }
 
+    Function* codeGenProto();
     Function* codeGen() override;
 };
 
@@ -111,6 +169,12 @@ class ExprAST : public BaseAST {
 protected:
     const char *colSTART = "\033[38;5;220m";
     const char *colEND = "\033[0m";
+public:
+    // 左值在 codeGenAddr 后记录所指向值的类型名 (INTEGER, REAL, 记录名...)
+    string type;
+
+    // 左值的地址, 非左值报错
+    virtual Value* codeGenAddr();
 };
 
 class BlockAST : public BaseAST {
@@ -149,27 +213,27 @@ public:
     Value* codeGen() override;
 };
 
-// class IntAST : public ExprAST {
-// protected:
-//     const char *colSTART = "\033[38;5;82m";
-//     const char *colEND = "\033[0m";
-// public:
-//     int value;
+class IntAST : public ExprAST {
+protected:
+    const char *colSTART = "\033[38;5;82m";
+    const char *colEND = "\033[0m";
+public:
+    int value;
 
-//     string getTypeName() const override {
-//         return "Int";
-//     }
+    string getTypeName() const override {
+        return "Int";
+    }
 
-//     void dump(string prefix, bool isLast) const override {
-//         if (isLast) {
-//             cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << ": " << value << endl;
-//         } else {
-//             cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << ": " << value << endl;
-//         }
-//     }
+    void dump(string prefix, bool isLast) const override {
+        if (isLast) {
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << ": " << value << endl;
+        } else {
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << ": " << value << endl;
+        }
+    }
 
-//     Value* codeGen() override;
-// };
+    Value* codeGen() override;
+};
 
 class OutputAST : public StmtAST {
 protected:
@@ -195,6 +259,31 @@ public:
     Value* codeGen() override;
 };
 
+class InputAST : public StmtAST {
+protected:
+    const char *colSTART = "\033[38;5;220m";
+    const char *colEND = "\033[0m";
+public:
+    // 读入的变量, 数组元素或记录字段
+    unique_ptr<ExprAST> lval;
+
+    string getTypeName() const override {
+        return "Input";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        if (isLast) {
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << endl;
+            lval->dump(prefix + "   ", 1);
+        } else {
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << endl;
+            lval->dump(prefix + "│  ", 1);
+        }
+    }
+
+    Value* codeGen() override;
+};
+
 class NumberAST : public ExprAST {
 protected:
     const char *colSTART = "\033[38;5;82m";
@@ -216,6 +305,48 @@ public:
     Value* codeGen() override;
 };
 
+class StringAST : public ExprAST {
+protected:
+    const char *colSTART = "\033[38;5;82m";
+    const char *colEND = "\033[0m";
+public:
+    string value;
+
+    string getTypeName() const override {
+        return "String";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        if (isLast) {
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << ": \"" << value << "\"" << endl;
+        } else {
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << ": \"" << value << "\"" << endl;
+        }
+    }
+    Value* codeGen() override;
+};
+
+class CharAST : public ExprAST {
+protected:
+    const char *colSTART = "\033[38;5;82m";
+    const char *colEND = "\033[0m";
+public:
+    char value;
+
+    string getTypeName() const override {
+        return "Char";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        if (isLast) {
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << ": '" << value << "'" << endl;
+        } else {
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << ": '" << value << "'" << endl;
+        }
+    }
+    Value* codeGen() override;
+};
+
 class VarExprAST : public ExprAST {
 public:
     string ident;
@@ -232,6 +363,97 @@ public:
         }
     }
 
+    Value* codeGen() override;
+    Value* codeGenAddr() override;
+};
+
+// 数组元素 ident[i, j]
+class IndexExprAST : public ExprAST {
+public:
+    string ident;
+    ExprList indexes;
+
+    string getTypeName() const override {
+        return "IndexExpr";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        string childPrefix = prefix + (isLast ? "   " : "│  ");
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << ": " << ident << this->colEND << endl;
+        for (auto index = indexes.begin(); index != indexes.end(); index++) {
+            (*index)->dump(childPrefix, index == indexes.end() - 1);
+        }
+    }
+
+    // 各维下标减去下界后的值, 供 struct-of-arrays 布局直接寻址字段
+    bool codeGenIndexes(vector<Value*> &idxs);
+    Value* codeGen() override;
+    Value* codeGenAddr() override;
+};
+
+// 记录字段 base.field
+class FieldExprAST : public ExprAST {
+public:
+    unique_ptr<ExprAST> base;
+    string field;
+
+    string getTypeName() const override {
+        return "FieldExpr";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        if (isLast) {
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << ": ." << field << this->colEND << endl;
+            base->dump(prefix + "   ", 1);
+        } else {
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << ": ." << field << this->colEND << endl;
+            base->dump(prefix + "│  ", 1);
+        }
+    }
+
+    Value* codeGen() override;
+    Value* codeGenAddr() override;
+};
+
+// 函数调用, 包括 LENGTH, MID 等内置函数
+class CallExprAST : public ExprAST {
+public:
+    string ident;
+    ExprList args;
+
+    string getTypeName() const override {
+        return "CallExpr";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        string childPrefix = prefix + (isLast ? "   " : "│  ");
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << ": " << ident << this->colEND << endl;
+        for (auto arg = args.begin(); arg != args.end(); arg++) {
+            (*arg)->dump(childPrefix, arg == args.end() - 1);
+        }
+    }
+
+    Value* codeGen() override;
+};
+
+// CALL ident(args)
+class CallAST : public StmtAST {
+public:
+    string ident;
+    ExprList args;
+
+    string getTypeName() const override {
+        return "Call";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        string childPrefix = prefix + (isLast ? "   " : "│  ");
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << ": " << ident << this->colEND << endl;
+        for (auto arg = args.begin(); arg != args.end(); arg++) {
+            (*arg)->dump(childPrefix, arg == args.end() - 1);
+        }
+    }
+
     Value* codeGen() override;
 };
 
@@ -254,6 +476,7 @@ public:
     }
 
     Value* codeGen() override;
+    Value* codeGenAddr() override;
 };
 
 class UnaryExprAST : public ExprAST {
@@ -323,10 +546,56 @@ public:
     Value* codeGen() override;
 };
 
-class VarAssignAST : public StmtAST {
+// TYPE ident ... ENDTYPE
+class TypeDefAST : public BaseAST {
+protected:
+    const char *colSTART = "\033[38;5;141m";
+    const char *colEND = "\033[0m";
 public:
-    // 先多套一层，看后期能否简化
     string ident;
+    unique_ptr<FieldList> fields = make_unique<FieldList>();
+
+    string getTypeName() const override {
+        return "TypeDef";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << " " << ident << this->colEND << endl;
+        for (auto field = fields->begin(); field != fields->end(); field++) {
+            (*field)->dump(prefix + (isLast ? "   " : "│  "), field == fields->end() - 1);
+        }
+    }
+
+    Value* codeGen() override;
+};
+
+class ArrDeclAST : public StmtAST {
+public:
+    string ident;
+    BoundList bounds;
+    string type;
+
+    string getTypeName() const override {
+        return "ArrDecl";
+    }
+
+    void dump(string prefix, bool isLast) const override {
+        cout << prefix << (isLast ? this->endPREFIX : this->midPREFIX) << this->colSTART << getTypeName() << " " << ident << ": ARRAY[";
+        for (auto bound = bounds.begin(); bound != bounds.end(); bound++) {
+            if (bound != bounds.begin())
+                cout << ", ";
+            cout << bound->first << ":" << bound->second;
+        }
+        cout << "] OF " << type << this->colEND << endl;
+    }
+
+    Value* codeGen() override;
+};
+
+class VarAssignAST : public StmtAST {
+public:
+    // 变量, 数组元素或记录字段
+    unique_ptr<ExprAST> lval;
     unique_ptr<ExprAST> expr;
 
     string getTypeName() const override {
@@ -335,10 +604,12 @@ public:
 
     void dump(string prefix, bool isLast) const override {
         if (isLast) {
-            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << " " << ident << this->colEND << endl;
+            cout << prefix << this->endPREFIX << this->colSTART << getTypeName() << this->colEND << endl;
+            lval->dump(prefix + "   ", 0);
             expr->dump(prefix + "   ", 1);
         } else {
-            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << " " << ident << this->colEND << endl;
+            cout << prefix << this->midPREFIX << this->colSTART << getTypeName() << this->colEND << endl;
+            lval->dump(prefix + "│  ", 0);
             expr->dump(prefix + "│  ", 1);
         }
     }
@@ -0,0 +1,176 @@
+#include "Backend.h"
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "AST.h"
+
+// makefile 中给出构建目录里的 runtime/runtime.bc, 可用环境变量 PC_RUNTIME_BC 覆盖
+#ifndef PC_RUNTIME_BC
+#define PC_RUNTIME_BC "runtime/runtime.bc"
+#endif
+
+// 生成代码的 CPU 和特性. JIT 的代码只在本机执行, 针对本机 CPU, 运行时函数内联进来也不受目标特性限制;
+// 目标文件可能拿到较旧的机器上运行, 默认用三元组的通用 CPU (与 clang 的默认相同), 由 --march 另行指定
+static pair<string, string> targetCPU(const Triple &triple) {
+    if (options.run || options.march == "native") {
+        SubtargetFeatures features;
+        StringMap<bool> hostFeatures;
+        if (sys::getHostCPUFeatures(hostFeatures)) {
+            for (auto &feature: hostFeatures)
+                features.AddFeature(feature.first(), feature.second);
+        }
+        return { sys::getHostCPUName().str(), features.getString() };
+    }
+    if (!options.march.empty())
+        return { options.march, "" };
+    return { triple.getArch() == Triple::x86_64 ? "x86-64" : "generic", "" };
+}
+
+TargetMachine* getTargetMachine() {
+    // TargetMachine 不能在线程间共享, --batch 时每个线程一个.
+    // --serve 的子进程沿用服务进程创建的 TargetMachine, CPU 不同时才重新创建
+    static thread_local unique_ptr<TargetMachine> targetMachine;
+    static thread_local pair<string, string> targetMachineCPU;
+    string triple = sys::getProcessTriple();
+    pair<string, string> cpu = targetCPU(Triple(triple));
+    if (targetMachine && cpu == targetMachineCPU)
+        return targetMachine.get();
+
+    static once_flag initialized;
+    std::call_once(initialized, []() {
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmPrinter();
+        InitializeNativeTargetAsmParser();
+    });
+
+    string error;
+    const Target* target = TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        logError(error.c_str());
+        return nullptr;
+    }
+
+    targetMachine.reset(target->createTargetMachine(triple, cpu.first, cpu.second, TargetOptions(), Reloc::PIC_));
+    targetMachineCPU = cpu;
+    return targetMachine.get();
+}
+
+string targetDescription(const TargetMachine &targetMachine) {
+    return targetMachine.getTargetTriple().str() + " " + targetMachine.getTargetCPU().str() + " "
+        + targetMachine.getTargetFeatureString().str();
+}
+
+bool setTarget(Module &module) {
+    TargetMachine* targetMachine = getTargetMachine();
+    if (!targetMachine)
+        return false;
+    module.setTargetTriple(targetMachine->getTargetTriple().str());
+    module.setDataLayout(targetMachine->createDataLayout());
+    return true;
+}
+
+const char* runtimeBitcodePath() {
+    const char *path = getenv("PC_RUNTIME_BC");
+    return path ? path : PC_RUNTIME_BC;
+}
+
+bool linkRuntime(Module &module) {
+    if (!setTarget(module))
+        return false;
+
+    SMDiagnostic diag;
+    unique_ptr<Module> runtime = parseIRFile(runtimeBitcodePath(), diag, module.getContext());
+    if (!runtime) {
+        diag.print("compiler", errs());
+        logError("cannot load runtime bitcode");
+        return false;
+    }
+    runtime->setTargetTriple(module.getTargetTriple());
+    runtime->setDataLayout(module.getDataLayout());
+
+    set<string> userFunctions;
+    for (auto &F: module) {
+        if (!F.isDeclaration())
+            userFunctions.insert(F.getName().str());
+    }
+    if (Linker::linkModules(module, std::move(runtime), Linker::LinkOnlyNeeded)) {
+        logError("cannot link runtime");
+        return false;
+    }
+
+    for (auto &F: module) {
+        if (F.isDeclaration() || userFunctions.count(F.getName().str()))
+            continue;
+        F.setLinkage(GlobalValue::InternalLinkage);
+        // 带 AVX2 等特性的实现只经函数指针调用, 保留其目标特性; 其余按本机 CPU 编译才能内联
+        if (F.getFnAttribute("target-features").getValueAsString().contains("avx"))
+            continue;
+        F.removeFnAttr("target-cpu");
+        F.removeFnAttr("target-features");
+        F.removeFnAttr("tune-cpu");
+        if (!F.hasFnAttribute(Attribute::NoInline))
+            F.addFnAttr(Attribute::InlineHint);
+    }
+    return true;
+}
+
+void optimizeModule(Module &module, int level) {
+    if (level <= 0)
+        return;
+    setTarget(module);
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PassBuilder passBuilder(getTargetMachine());
+    passBuilder.registerModuleAnalyses(MAM);
+    passBuilder.registerCGSCCAnalyses(CGAM);
+    passBuilder.registerFunctionAnalyses(FAM);
+    passBuilder.registerLoopAnalyses(LAM);
+    passBuilder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    OptimizationLevel levels[] = { OptimizationLevel::O1, OptimizationLevel::O2, OptimizationLevel::O3 };
+    ModulePassManager MPM = passBuilder.buildPerModuleDefaultPipeline(levels[min(level, 3) - 1]);
+    MPM.run(module, MAM);
+}
+
+bool emitFile(Module &module, const string &path) {
+    if (!setTarget(module))
+        return false;
+
+    error_code ec;
+    raw_fd_ostream out(path, ec, sys::fs::OF_None);
+    if (ec) {
+        logError(ec.message().c_str());
+        return false;
+    }
+
+    StringRef ext(path);
+    if (ext.endswith(".ll")) {
+        module.print(out, nullptr);
+    } else if (ext.endswith(".bc")) {
+        WriteBitcodeToFile(module, out);
+    } else {
+        legacy::PassManager pass;
+        if (getTargetMachine()->addPassesToEmitFile(pass, out, nullptr, CGFT_ObjectFile)) {
+            logError("target cannot emit object files");
+            return false;
+        }
+        pass.run(module);
+    }
+    out.flush();
+    return true;
+}
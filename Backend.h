@@ -0,0 +1,36 @@
+#ifndef __BACKEND_H__
+#define __BACKEND_H__
+
+// 生成 IR 之后的步骤: 链接运行时, 优化, 输出文件
+
+#include <string>
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace std;
+using namespace llvm;
+
+// 本机的 TargetMachine (每个线程一个), 第一次调用时才初始化 LLVM 的目标
+TargetMachine* getTargetMachine();
+
+// 目标三元组, CPU 和特性; 为不同的 CPU 生成的代码不同, 缓存的键要包含它
+string targetDescription(const TargetMachine &targetMachine);
+
+// 把本机的三元组和 DataLayout 设到 module 上; 代码生成之前就要设好,
+// 局部变量的清零, BYREF 参数的 dereferenceable 和对齐都按它计算
+bool setTarget(Module &module);
+
+// 把 runtime/runtime.bc 链接进 module; 运行时函数改为 internal 并加 inlinehint,
+// 优化时可以内联进调用处, 没用到的被删掉
+bool linkRuntime(Module &module);
+
+// PC_RUNTIME_BC 或构建时给出的 runtime.bc 路径
+const char* runtimeBitcodePath();
+
+// 对应 -O0 ~ -O3 的默认流水线
+void optimizeModule(Module &module, int level);
+
+// 按扩展名输出 .ll, .bc, 其它都输出目标文件
+bool emitFile(Module &module, const string &path);
+
+#endif
@@ -0,0 +1,127 @@
+#include "Batch.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "AST.h"
+#include "Backend.h"
+#include "Cache.h"
+#include "Compile.h"
+#include "Options.h"
+
+bool collectInputs(const string &source, StringRef extension, vector<string> &inputs) {
+    if (sys::fs::is_directory(source)) {
+        error_code ec;
+        for (sys::fs::directory_iterator it(source, ec), end; it != end && !ec; it.increment(ec)) {
+            if (sys::path::extension(it->path()) == extension)
+                inputs.push_back(it->path());
+        }
+        // 目录的遍历顺序不固定, 排序后输出才稳定
+        llvm::sort(inputs);
+        return !ec;
+    }
+
+    ifstream list(source);
+    if (!list)
+        return false;
+    string line;
+    while (getline(list, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == string::npos || line[begin] == '#')
+            continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        inputs.push_back(line.substr(begin, end - begin + 1));
+    }
+    return true;
+}
+
+static string outputPath(const string &input, const char *extension) {
+    SmallString<256> path(options.output.empty() ? sys::path::parent_path(input) : StringRef(options.output));
+    sys::path::append(path, sys::path::stem(input) + extension);
+    return path.str().str();
+}
+
+// 在当前线程编译一个文件, 诊断信息收集到 log 中
+static bool compileOne(const string &input, string &log) {
+    ostringstream buffer;
+    diagnostics = &buffer;
+    string output = outputPath(input, ".o");
+    string key = options.cache ? cacheKey(input, "o") : "";
+    bool ok = !key.empty() && cacheFetchFile(key, output);
+    if (ok) {
+        // 缓存命中
+    } else if (unique_ptr<BaseAST> ast = parseFile(input)) {
+        ok = generateModule(*ast) && emitFile(*getModule(), output);
+        if (ok && !key.empty())
+            cacheStoreFile(key, output);
+    }
+    // 每个文件的 Module 和 context 编译完就释放
+    takeModule();
+    diagnostics = &cout;
+    log = buffer.str();
+    return ok;
+}
+
+int runBatch(const string &source) {
+    vector<string> inputs;
+    if (!collectInputs(source, ".pc", inputs)) {
+        logError("cannot read batch list");
+        return 1;
+    }
+    if (!options.output.empty()) {
+        if (error_code ec = sys::fs::create_directories(options.output)) {
+            logError(("cannot create " + options.output + ": " + ec.message()).c_str());
+            return 1;
+        }
+    }
+
+    size_t jobs = options.jobs > 0 ? options.jobs : max(1u, thread::hardware_concurrency());
+    jobs = max<size_t>(1, min(jobs, inputs.size()));
+    CompilerOptions shared = options;
+    shared.dumpAST = false;
+
+    // 文件之间互不依赖, 各线程从同一个计数器领取下一个文件, 先做完的线程自然多做
+    atomic<size_t> next(0);
+    atomic<int> failed(0);
+    mutex outputMutex;
+    auto worker = [&]() {
+        options = shared;
+        for (size_t i; (i = next.fetch_add(1)) < inputs.size();) {
+            const string &input = inputs[i];
+            options.input = input;
+            string log;
+            bool ok = compileOne(input, log);
+            string logPath = outputPath(input, ".log");
+            if (log.empty()) {
+                sys::fs::remove(logPath);
+            } else {
+                ofstream file(logPath);
+                file << log;
+            }
+            if (!ok)
+                failed++;
+
+            lock_guard<mutex> lock(outputMutex);
+            cout << (ok ? "ok      " : "FAILED  ") << input;
+            if (!log.empty())
+                cout << " (" << logPath << ")";
+            cout << "\n";
+        }
+    };
+    vector<thread> threads;
+    for (size_t i = 1; i < jobs; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &t: threads)
+        t.join();
+
+    cout << inputs.size() - failed << "/" << inputs.size() << " compiled" << endl;
+    return failed;
+}
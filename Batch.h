@@ -0,0 +1,21 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+// --batch: 在一个进程中用多个线程编译许多文件, 省去每个文件启动进程和初始化 LLVM 的开销
+
+#include <string>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+
+using namespace std;
+using namespace llvm;
+
+// source 是列表文件 (每行一个路径, 空行和 # 开头的行忽略) 或目录 (其中所有 .pc 文件).
+// 每个文件输出同名的目标文件 .o, 有诊断信息时另写同名的 .log; -o 给出输出目录, 默认与源文件同目录.
+// 每个文件一行结果输出到 stdout, 返回失败的文件数
+int runBatch(const string &source);
+
+// 读取列表文件中的路径, 或目录中扩展名为 extension 的文件 (按名字排序)
+bool collectInputs(const string &source, StringRef extension, vector<string> &inputs);
+
+#endif
@@ -0,0 +1,261 @@
+#include "Cache.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <sys/file.h>
+#include <unistd.h>
+#include <utime.h>
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+#include "Backend.h"
+#include "Options.h"
+
+// 缓存格式或键的组成变化时加一
+#define CACHE_FORMAT 1
+
+static string cacheDir() {
+    if (const char *dir = getenv("PC_CACHE_DIR"))
+        return dir;
+    SmallString<256> path;
+    if (const char *xdg = getenv("XDG_CACHE_HOME")) {
+        path = xdg;
+    } else if (const char *home = getenv("HOME")) {
+        path = home;
+        sys::path::append(path, ".cache");
+    } else {
+        path = "/tmp";
+    }
+    sys::path::append(path, "pc-compiler");
+    return path.str().str();
+}
+
+static uint64_t cacheLimit() {
+    const char *size = getenv("PC_CACHE_SIZE");
+    uint64_t mib = size ? strtoull(size, nullptr, 10) : 0;
+    return (mib ? mib : 256) << 20;
+}
+
+static string entryPath(const string &key) {
+    SmallString<256> path(cacheDir());
+    sys::path::append(path, key.substr(0, 2), key);
+    return path.str().str();
+}
+
+// 去掉注释, 行尾空白和 '\r'; 保留换行, 行号 (--profile) 不变
+static string normalizeSource(StringRef source) {
+    string result;
+    result.reserve(source.size());
+    char quote = 0;
+    for (size_t i = 0; i < source.size(); i++) {
+        char c = source[i];
+        if (quote) {
+            if (c == quote || c == '\n')
+                quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+            while (i + 1 < source.size() && source[i + 1] != '\n')
+                i++;
+            continue;
+        } else if (c == '\n' || c == '\r') {
+            while (!result.empty() && (result.back() == ' ' || result.back() == '\t'))
+                result.pop_back();
+            if (c == '\r')
+                continue;
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+// 编译器本身以可执行文件的大小和修改时间代表. 目标机器也计入: 共享的缓存目录 (如 NFS 上)
+// 不能把为一台机器的 CPU 特性生成的目标文件交给另一台机器
+static void hashCompiler(SHA256 &hash) {
+    hash.update(StringRef("pc-compiler " LLVM_VERSION_STRING " "));
+    hash.update(to_string(CACHE_FORMAT));
+    sys::fs::file_status status;
+    if (!sys::fs::status("/proc/self/exe", status)) {
+        hash.update(to_string(status.getSize()));
+        hash.update(to_string(sys::toTimeT(status.getLastModificationTime())));
+    }
+    if (TargetMachine* targetMachine = getTargetMachine())
+        hash.update(" " + targetDescription(*targetMachine));
+}
+
+string cacheKey(const string &input, StringRef kind) {
+    auto source = MemoryBuffer::getFile(input);
+    if (!source)
+        return "";
+    SHA256 hash;
+    hashCompiler(hash);
+    // 链接进来的运行时也是输出的一部分
+    if (options.runtime) {
+        if (auto runtime = MemoryBuffer::getFile(runtimeBitcodePath()))
+            hash.update((*runtime)->getBuffer());
+    }
+    string flags = "kind=" + kind.str() + " O" + to_string(options.optLevel) + " soa=" + to_string(options.soa)
+        + " runtime=" + to_string(options.runtime) + " memoize=" + to_string(options.memoize)
+        + " profile=" + to_string(options.profile);
+    // --profile 的报告中含有源文件路径
+    if (options.profile)
+        flags += " input=" + input;
+    hash.update(flags);
+    hash.update(StringRef("\0", 1));
+    hash.update(normalizeSource((*source)->getBuffer()));
+    return toHex(hash.final(), true);
+}
+
+string cacheKeyOf(StringRef kind, StringRef data) {
+    SHA256 hash;
+    hashCompiler(hash);
+    hash.update("kind=" + kind.str());
+    hash.update(StringRef("\0", 1));
+    hash.update(data);
+    return toHex(hash.final(), true);
+}
+
+// 统计存放在缓存目录的 stats 文件中, 多个进程之间用 flock 互斥
+static void updateStats(int hits, int misses, int evictions) {
+    string dir = cacheDir();
+    SmallString<256> path(dir);
+    sys::path::append(path, "stats");
+    if (sys::fs::create_directories(dir))
+        return;
+    FILE *file = fopen(path.c_str(), "a+");
+    if (!file)
+        return;
+    flock(fileno(file), LOCK_EX);
+    unsigned long long counts[3] = { 0, 0, 0 };
+    rewind(file);
+    if (fscanf(file, "hits %llu misses %llu evictions %llu", &counts[0], &counts[1], &counts[2]) != 3)
+        counts[0] = counts[1] = counts[2] = 0;
+    counts[0] += hits;
+    counts[1] += misses;
+    counts[2] += evictions;
+    if (ftruncate(fileno(file), 0) == 0)
+        fprintf(file, "hits %llu misses %llu evictions %llu\n", counts[0], counts[1], counts[2]);
+    fclose(file);
+}
+
+unique_ptr<MemoryBuffer> cacheLookup(const string &key) {
+    string path = entryPath(key);
+    auto buffer = MemoryBuffer::getFile(path);
+    if (!buffer) {
+        updateStats(0, 1, 0);
+        return nullptr;
+    }
+    // 修改时间即最近使用时间
+    utime(path.c_str(), nullptr);
+    updateStats(1, 0, 0);
+    return std::move(*buffer);
+}
+
+struct Entry {
+    string path;
+    uint64_t size;
+    sys::TimePoint<> used;
+};
+
+// 超过上限时从最久未用的项开始删, 删到上限的 90%
+static void evict() {
+    vector<Entry> entries;
+    uint64_t total = 0;
+    error_code ec;
+    for (sys::fs::recursive_directory_iterator it(cacheDir(), ec), end; it != end && !ec; it.increment(ec)) {
+        sys::fs::file_status status;
+        if (it.level() != 1 || sys::fs::status(it->path(), status) || status.type() != sys::fs::file_type::regular_file)
+            continue;
+        entries.push_back({ it->path(), status.getSize(), status.getLastModificationTime() });
+        total += status.getSize();
+    }
+    uint64_t limit = cacheLimit();
+    if (total <= limit)
+        return;
+    llvm::sort(entries, [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    int evicted = 0;
+    for (auto &entry: entries) {
+        if (total <= limit / 10 * 9)
+            break;
+        if (!sys::fs::remove(entry.path)) {
+            total -= entry.size;
+            evicted++;
+        }
+    }
+    updateStats(0, 0, evicted);
+}
+
+void cacheStore(const string &key, StringRef data) {
+    string path = entryPath(key);
+    if (sys::fs::create_directories(sys::path::parent_path(path)))
+        return;
+    // 先写临时文件再改名, 并发的读者不会看到写了一半的项; 临时文件名由 LLVM 随机生成, 线程和进程之间不会冲突
+    int fd;
+    SmallString<256> temp;
+    if (sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, temp))
+        return;
+    {
+        raw_fd_ostream out(fd, true);
+        out << data;
+        if (out.has_error()) {
+            out.clear_error();
+            sys::fs::remove(temp);
+            return;
+        }
+    }
+    if (sys::fs::rename(temp, path)) {
+        sys::fs::remove(temp);
+        return;
+    }
+    evict();
+}
+
+bool cacheFetchFile(const string &key, const string &path) {
+    unique_ptr<MemoryBuffer> data = cacheLookup(key);
+    if (!data)
+        return false;
+    error_code ec;
+    raw_fd_ostream out(path, ec, sys::fs::OF_None);
+    if (ec)
+        return false;
+    out << data->getBuffer();
+    return true;
+}
+
+void cacheStoreFile(const string &key, const string &path) {
+    if (auto data = MemoryBuffer::getFile(path))
+        cacheStore(key, (*data)->getBuffer());
+}
+
+void printCacheStats() {
+    string dir = cacheDir();
+    SmallString<256> statsPath(dir);
+    sys::path::append(statsPath, "stats");
+    unsigned long long hits = 0, misses = 0, evictions = 0;
+    if (FILE *file = fopen(statsPath.c_str(), "r")) {
+        if (fscanf(file, "hits %llu misses %llu evictions %llu", &hits, &misses, &evictions) != 3)
+            hits = misses = evictions = 0;
+        fclose(file);
+    }
+    uint64_t entries = 0, total = 0;
+    error_code ec;
+    for (sys::fs::recursive_directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+        sys::fs::file_status status;
+        if (it.level() == 1 && !sys::fs::status(it->path(), status) && status.type() == sys::fs::file_type::regular_file) {
+            entries++;
+            total += status.getSize();
+        }
+    }
+    cout << "cache directory: " << dir << "\n"
+         << "entries:         " << entries << "\n"
+         << "size:            " << (total >> 10) << " KiB of " << (cacheLimit() >> 10) << " KiB\n"
+         << "hits:            " << hits << "\n"
+         << "misses:          " << misses << "\n"
+         << "hit rate:        " << (hits + misses ? 100 * hits / (hits + misses) : 0) << "%\n"
+         << "evictions:       " << evictions << endl;
+}
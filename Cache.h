@@ -0,0 +1,33 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+// --cache: 以内容为键的磁盘缓存. 键是规范化后的源代码, 编译器版本, 目标机器 (三元组, CPU 和特性), 运行时 bitcode 和影响输出的选项
+// 的 SHA-256; 值是优化后的 bitcode 或目标文件. 目录为 $PC_CACHE_DIR (默认 ~/.cache/pc-compiler),
+// 总大小超过 $PC_CACHE_SIZE MiB (默认 256) 时按最近使用时间淘汰
+
+#include <memory>
+#include <string>
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace std;
+using namespace llvm;
+
+// kind 区分同一源代码的不同产物 ("bc" 或 "o"); 读不到源文件时返回空串
+string cacheKey(const string &input, StringRef kind);
+// 由编译器版本, kind 和任意内容 (如 IR 的 bitcode) 组成的键
+string cacheKeyOf(StringRef kind, StringRef data);
+
+// 未命中返回 nullptr; 命中同时更新该项的使用时间
+unique_ptr<MemoryBuffer> cacheLookup(const string &key);
+void cacheStore(const string &key, StringRef data);
+
+// 命中时把缓存的内容写到 path
+bool cacheFetchFile(const string &key, const string &path);
+// 把已经生成的 path 存入缓存
+void cacheStoreFile(const string &key, const string &path);
+
+// --cache-stats: 命中, 未命中, 淘汰的次数以及当前的大小
+void printCacheStats();
+
+#endif
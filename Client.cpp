@@ -0,0 +1,129 @@
+// compiler 的客户端, 用法与 compiler 完全相同: 参数原样交给 compiler --serve 启动的服务进程,
+// 省去每次启动进程和初始化 LLVM 的开销. 连不上服务时直接执行 compiler
+// ($PC_COMPILER, 默认是与本程序同一目录下的 compiler)
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Server.h"
+
+extern char **environ;
+
+static void appendString(string &payload, const char *s) {
+    payload.append(s);
+    payload.push_back('\0');
+}
+
+static bool writeFully(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int connectServer() {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    string path = serverSocketPath();
+    if (path.size() >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, path.c_str());
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock >= 0 && connect(sock, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    // 请求里有标准输入输出, 工作目录和全部环境变量, 只交给同一用户的服务进程
+    ucred peer;
+    socklen_t size = sizeof(peer);
+    if (sock >= 0 && (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &peer, &size) != 0 || peer.uid != getuid())) {
+        fprintf(stderr, "compiler-client: %s is not served by this user, ignoring it\n", path.c_str());
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+[[noreturn]] static void execCompiler(char *argv[]) {
+    string compiler;
+    if (const char *path = getenv("PC_COMPILER")) {
+        compiler = path;
+    } else {
+        char self[PATH_MAX];
+        ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+        compiler = n > 0 ? string(self, n) : string("./compiler-client");
+        compiler = compiler.substr(0, compiler.rfind('/') + 1) + "compiler";
+    }
+    argv[0] = const_cast<char *>(compiler.c_str());
+    execv(argv[0], argv);
+    fprintf(stderr, "compiler-client: cannot run %s: %s\n", argv[0], strerror(errno));
+    _exit(127);
+}
+
+int main(int argc, char *argv[]) {
+    int sock = connectServer();
+    if (sock < 0)
+        execCompiler(argv);
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("compiler-client: getcwd");
+        return 1;
+    }
+    string payload;
+    appendString(payload, cwd);
+    // 服务进程的子进程把这些参数当作自己的 argv, argv[0] 也一并传过去
+    appendString(payload, to_string(argc).c_str());
+    for (int i = 0; i < argc; i++)
+        appendString(payload, argv[i]);
+    for (char **env = environ; *env; env++)
+        appendString(payload, *env);
+    if (payload.size() > SERVER_MAX_REQUEST) {
+        close(sock);
+        execCompiler(argv);
+    }
+
+    // 长度字段附带本进程的标准输入输出
+    uint32_t size = payload.size();
+    iovec iov = { &size, sizeof(size) };
+    int fds[3] = { 0, 1, 2 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg(sock, &msg, 0) != sizeof(size) || !writeFully(sock, payload.data(), payload.size())) {
+        perror("compiler-client: cannot send request");
+        return 1;
+    }
+
+    int32_t code;
+    for (size_t got = 0; got < sizeof(code);) {
+        ssize_t n = read(sock, (char *)&code + got, sizeof(code) - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            fprintf(stderr, "compiler-client: lost connection to the server\n");
+            return 1;
+        }
+        got += n;
+    }
+    return code;
+}
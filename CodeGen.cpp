@@ -1,19 +1,78 @@
 #include "CodeGen.h"
+#include "Backend.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cstddef>
 #include <llvm-16/llvm/IR/IRBuilder.h>
 #include <llvm-16/llvm/IR/LLVMContext.h>
 #include <memory>
+#include <set>
 
 
+thread_local ostream* diagnostics = &cout;
+
 Value* logError(const char *str) {
-    cout << "error: " << str;
+    *diagnostics << "error: " << str << endl;
     return nullptr;
 }
 
+// 正在生成的语句 (或顶层定义) 的位置, 静态辅助函数中的错误报告在这里
+static thread_local SourceRange statementRange;
+// 当前语句已经报告过错误, 外层节点随之失败时不再重复报告
+static thread_local bool statementFailed = false;
+
+Value* logError(const char *str, SourceRange range) {
+    if (statementFailed)
+        return nullptr;
+    statementFailed = true;
+    LineColumn position = sourceFile->locate(range.begin);
+    *diagnostics << "error: line " << position.line << ", column " << position.column << ": " << str << endl;
+    return nullptr;
+}
+
+// 生成一条语句或一个顶层定义期间设置 statementRange, 结束后恢复外层语句的位置
+class StatementScope {
+    SourceRange outer;
+public:
+    StatementScope(SourceRange range) : outer(statementRange) {
+        statementRange = range;
+        statementFailed = false;
+    }
+    ~StatementScope() {
+        statementRange = outer;
+    }
+};
+
+Module* getModule() {
+    return module.get();
+}
+
+pair<unique_ptr<LLVMContext>, unique_ptr<Module>> takeModule() {
+    // 它们引用着 context, 先于 context 释放
+    fpm.reset();
+    builder.reset();
+    unique_ptr<Module> M = std::move(module);
+    return make_pair(std::move(context), std::move(M));
+}
+
 static void initializeModuleAndPassManager() {
+    // 同一线程编译上一个文件留下的 Module 引用着旧的 context, 先于它释放
+    takeModule();
+    namedValues.clear();
+    globalValues.clear();
+    records.clear();
+    functions.clear();
+    profileCounters = nullptr;
+    profileLines.clear();
+
     context = make_unique<LLVMContext>();
     module = make_unique<Module>("my cool jit", *context);
+    // --check 不初始化目标, 按默认的 DataLayout 生成; 生成的 IR 随即丢弃
+    if (!options.check)
+        setTarget(*module);
     builder = make_unique<IRBuilder<>>(*context);
+    stringType = StructType::create(*context, { Type::getInt64Ty(*context), Type::getInt64Ty(*context) }, "STRING");
 
     fpm = make_unique<legacy::FunctionPassManager>(module.get());
     fpm->add(createInstructionCombiningPass());
@@ -24,32 +83,490 @@ static void initializeModuleAndPassManager() {
     fpm->doInitialization();
 }
 
+// 类型名对应的 LLVM 类型, 未知类型返回 nullptr
+static Type* getType(const string &type) {
+    if (type == "INTEGER")
+        return Type::getInt32Ty(*context);
+    if (type == "REAL")
+        return Type::getDoubleTy(*context);
+    if (type == "BOOLEAN")
+        return Type::getInt1Ty(*context);
+    if (type == "CHAR")
+        return Type::getInt8Ty(*context);
+    if (type == "STRING")
+        return stringType;
+    auto record = records.find(type);
+    if (record != records.end())
+        return record->second.type;
+    return nullptr;
+}
+
+// ARRAY[l1:u1, l2:u2] OF elem 即 [n1 x [n2 x elem]]
+static Type* getArrayType(Type* elemType, const BoundList &bounds) {
+    Type* ty = elemType;
+    for (auto bound = bounds.rbegin(); bound != bounds.rend(); bound++)
+        ty = ArrayType::get(ty, bound->second - bound->first + 1);
+    return ty;
+}
+
+// 变量本身的类型; struct-of-arrays 的数组是每个字段一个数组组成的结构体
+static Type* getSymbolType(const Symbol &sym) {
+    Type* elemType = getType(sym.type);
+    if (!elemType || sym.bounds.empty())
+        return elemType;
+    if (!sym.soa)
+        return getArrayType(elemType, sym.bounds);
+
+    vector<Type*> fieldArrays;
+    for (auto &fieldType: records[sym.type].fieldTypes)
+        fieldArrays.push_back(getArrayType(getType(fieldType), sym.bounds));
+    return StructType::get(*context, fieldArrays);
+}
+
+static Symbol* findSymbol(const string &ident) {
+    auto local = namedValues.find(ident);
+    if (local != namedValues.end())
+        return &local->second;
+    auto global = globalValues.find(ident);
+    if (global != globalValues.end())
+        return &global->second;
+    return nullptr;
+}
+
+static AllocaInst* createEntryBlockAlloca(Type* ty, const string &name) {
+    Function* func = builder->GetInsertBlock()->getParent();
+    IRBuilder<> entry(&func->getEntryBlock(), func->getEntryBlock().begin());
+    return entry.CreateAlloca(ty, nullptr, name);
+}
+
+// 顶层 (main 中) 的 DECLARE 是全局变量, 过程内的在入口块 alloca
+static Value* declareSymbol(const string &ident, Symbol sym) {
+    Type* ty = getSymbolType(sym);
+    if (!ty)
+        return logError("unknown type", statementRange);
+
+    Function* func = builder->GetInsertBlock()->getParent();
+    if (func == mainFunction) {
+        if (globalValues.count(ident))
+            return logError("variable redeclared", statementRange);
+        sym.addr = new GlobalVariable(*module, ty, false, GlobalValue::InternalLinkage,
+                                      Constant::getNullValue(ty), ident);
+        globalValues[ident] = sym;
+    } else {
+        if (namedValues.count(ident))
+            return logError("variable redeclared", statementRange);
+        sym.addr = createEntryBlockAlloca(ty, ident);
+        // 与全局变量一样从全零开始, STRING 即空串
+        if (ty->isAggregateType()) {
+            uint64_t size = module->getDataLayout().getTypeAllocSize(ty).getFixedSize();
+            builder->CreateMemSet(sym.addr, builder->getInt8(0), size, MaybeAlign());
+        } else {
+            builder->CreateStore(Constant::getNullValue(ty), sym.addr);
+        }
+        namedValues[ident] = sym;
+    }
+    return sym.addr;
+}
+
+// runtime/runtime.h 中的函数
+static FunctionCallee getRuntimeFunction(const char *name, Type* ret, ArrayRef<Type*> params) {
+    return module->getOrInsertFunction(name, FunctionType::get(ret, params, false));
+}
+
+// 运行时的字符串函数都按指针传 pc_string, 先把值存入临时变量
+static Value* stringAddr(Value* str) {
+    Value* tmp = createEntryBlockAlloca(stringType, "strtmp");
+    builder->CreateStore(str, tmp);
+    return tmp;
+}
+
+// 调用 void f(pc_string *out, ...) 形式的运行时函数, 返回 *out
+static Value* callStringFunction(const char *name, ArrayRef<Value*> args) {
+    Value* out = createEntryBlockAlloca(stringType, "strtmp");
+    vector<Type*> params = { out->getType() };
+    vector<Value*> callArgs = { out };
+    for (Value* arg: args) {
+        params.push_back(arg->getType());
+        callArgs.push_back(arg);
+    }
+    builder->CreateCall(getRuntimeFunction(name, builder->getVoidTy(), params), callArgs);
+    return builder->CreateLoad(stringType, out, "str");
+}
+
+// 赋值时的隐式类型转换
+static Value* castTo(Value* V, Type* ty) {
+    Type* from = V->getType();
+    if (from == ty)
+        return V;
+    if (ty == stringType && from->isIntegerTy(8))
+        return callStringFunction("pc_string_from_char", { V });
+    if (from->isIntegerTy(1) && ty->isIntegerTy())
+        return builder->CreateZExt(V, ty, "booltmp");
+    if (from->isIntegerTy() && ty->isIntegerTy(1))
+        return builder->CreateICmpNE(V, ConstantInt::get(from, 0), "booltmp");
+    if (from->isIntegerTy() && ty->isIntegerTy())
+        return builder->CreateSExtOrTrunc(V, ty, "inttmp");
+    if (from->isIntegerTy() && ty->isFloatingPointTy())
+        return builder->CreateSIToFP(V, ty, "realtmp");
+    if (from->isFloatingPointTy() && ty->isIntegerTy())
+        return builder->CreateFPToSI(V, ty, "inttmp");
+    return logError("type mismatch", statementRange);
+}
+
+// 按左值记录的类型读出其值
+static Value* loadLValue(ExprAST *lval, const string &name) {
+    Value* addr = lval->codeGenAddr();
+    if (!addr)
+        return nullptr;
+    return builder->CreateLoad(getType(lval->type), addr, name);
+}
+
+static int getFieldNo(const Record &record, const string &field) {
+    auto it = find(record.fieldNames.begin(), record.fieldNames.end(), field);
+    if (it == record.fieldNames.end())
+        return -1;
+    return it - record.fieldNames.begin();
+}
+
+// 函数及其 (直接或间接) 调用的函数中直接访问的全局变量
+static map<Function*, set<Value*>> collectUsedGlobals() {
+    map<Function*, set<Value*>> used;
+    map<Function*, set<Function*>> callees;
+    for (auto &entry: functions) {
+        Function* func = entry.second.func;
+        for (auto &block: *func) {
+            for (auto &inst: block) {
+                for (Value* operand: inst.operands()) {
+                    Value* object = getUnderlyingObject(operand);
+                    if (isa<GlobalVariable>(object))
+                        used[func].insert(object);
+                    else if (auto *callee = dyn_cast<Function>(object))
+                        callees[func].insert(callee);
+                }
+            }
+        }
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto &entry: callees) {
+            set<Value*> &globals = used[entry.first];
+            size_t before = globals.size();
+            for (Function* callee: entry.second) {
+                auto it = used.find(callee);
+                if (it != used.end() && callee != entry.first)
+                    globals.insert(it->second.begin(), it->second.end());
+            }
+            changed |= globals.size() != before;
+        }
+    }
+    return used;
+}
+
+// 所有调用点上, BYREF 实参都是互不相同的变量, 且被调用者不会通过变量名
+// 访问它时, 这个参数是 noalias, 循环中对它的读写可以提升到寄存器
+static void addNoAliasAttributes() {
+    map<Function*, set<Value*>> usedGlobals = collectUsedGlobals();
+    for (auto &entry: functions) {
+        Function* func = entry.second.func;
+        for (auto &arg: func->args()) {
+            if (!arg.getType()->isPointerTy())
+                continue;
+            bool noAlias = true;
+            for (User* user: func->users()) {
+                auto *call = dyn_cast<CallInst>(user);
+                if (!call || call->getCalledFunction() != func) {
+                    noAlias = false;
+                    break;
+                }
+                Value* object = getUnderlyingObject(call->getArgOperand(arg.getArgNo()));
+                if (!isa<AllocaInst>(object) && !isa<GlobalVariable>(object))
+                    noAlias = false;
+                else if (usedGlobals[func].count(object))
+                    noAlias = false;
+                for (auto &other: func->args()) {
+                    if (&other != &arg && other.getType()->isPointerTy()
+                        && getUnderlyingObject(call->getArgOperand(other.getArgNo())) == object)
+                        noAlias = false;
+                }
+            }
+            if (noAlias)
+                arg.addAttr(Attribute::NoAlias);
+        }
+    }
+}
+
+// --profile: 语句执行前把它的计数器加一
+static void countStatement(const StmtAST *stmt) {
+    if (!options.profile)
+        return;
+    Type* countTy = builder->getInt64Ty();
+    if (!profileCounters)
+        profileCounters = new GlobalVariable(*module, countTy, false, GlobalValue::InternalLinkage,
+                                             Constant::getNullValue(countTy), "pc.profile.placeholder");
+    Value* counter = builder->CreateConstInBoundsGEP1_32(countTy, profileCounters, profileLines.size(), "counter");
+    profileLines.push_back(sourceFile ? sourceFile->locate(stmt->range.begin).line : 0);
+    Value* count = builder->CreateLoad(countTy, counter, "count");
+    builder->CreateStore(builder->CreateAdd(count, builder->getInt64(1), "count"), counter);
+}
+
+// 生成计数器数组和行号表, main 开始时交给运行时
+static void registerProfile() {
+    if (!profileCounters)
+        return;
+    Type* countTy = builder->getInt64Ty();
+    ArrayType* countsTy = ArrayType::get(countTy, profileLines.size());
+    auto *counts = new GlobalVariable(*module, countsTy, false, GlobalValue::InternalLinkage,
+                                      Constant::getNullValue(countsTy), "pc.profile.counts");
+    profileCounters->replaceAllUsesWith(counts);
+    profileCounters->eraseFromParent();
+    profileCounters = counts;
+
+    Constant* linesInit = ConstantDataArray::get(*context, makeArrayRef(profileLines));
+    auto *lines = new GlobalVariable(*module, linesInit->getType(), true, GlobalValue::PrivateLinkage,
+                                     linesInit, "pc.profile.lines");
+    SmallString<256> source(options.input);
+    sys::fs::make_absolute(source);
+
+    builder->SetInsertPoint(&mainFunction->getEntryBlock(), mainFunction->getEntryBlock().begin());
+    Type* ptrTy = PointerType::getUnqual(*context);
+    Type* i32Ty = builder->getInt32Ty();
+    builder->CreateCall(getRuntimeFunction("pc_profile_register", builder->getVoidTy(), { ptrTy, ptrTy, ptrTy, i32Ty }),
+                        { builder->CreateGlobalStringPtr(source.str(), "pc.profile.source"), lines, counts,
+                          builder->getInt32(profileLines.size()) });
+}
+
 Value* CompUnitAST::codeGen() {
     initializeModuleAndPassManager();
+    sourceFile = this->source.get();
     this->codeGenDump();
-    Value* ret = this->def->codeGen();
-    if (!ret) 
-        return logError("error in compunit");
-    return ret;
+
+    // --check 时出错的语句和定义各报告一次, 跳过它们继续检查, 最后整体失败
+    bool failed = false;
+
+    // 记录类型先于所有语句生成
+    for (auto &def: this->defs) {
+        auto *typeDef = dynamic_cast<TypeDefAST *>(def.get());
+        if (!typeDef)
+            continue;
+        StatementScope scope(def->range);
+        if (!typeDef->codeGen()) {
+            if (!options.check)
+                return logError("error in compunit", def->range);
+            failed = true;
+        }
+    }
+
+    FunctionType* mainType = FunctionType::get(builder->getInt32Ty(), false);
+    mainFunction = Function::Create(mainType, Function::ExternalLinkage, "main", module.get());
+
+    // 所有 FUNCTION/PROCEDURE 先声明, 调用可以出现在定义之前
+    set<BaseAST *> badProtos;
+    for (auto &def: this->defs) {
+        StatementScope scope(def->range);
+        Function* proto = nullptr;
+        if (auto *funcDef = dynamic_cast<FuncDefAST *>(def.get()))
+            proto = funcDef->codeGenProto();
+        else if (auto *procDef = dynamic_cast<ProcDefAST *>(def.get()))
+            proto = procDef->codeGenProto();
+        else
+            continue;
+        if (!proto) {
+            if (!options.check)
+                return logError("error in compunit", def->range);
+            badProtos.insert(def.get());
+            failed = true;
+        }
+    }
+
+    builder->SetInsertPoint(BasicBlock::Create(*context, "entry", mainFunction));
+    for (auto &def: this->defs) {
+        auto *stmt = dynamic_cast<StmtAST *>(def.get());
+        if (!stmt)
+            continue;
+        countStatement(stmt);
+        StatementScope scope(stmt->range);
+        if (!stmt->codeGen()) {
+            if (!options.check)
+                return logError("error in compunit", stmt->range);
+            failed = true;
+        }
+    }
+    // OUTPUT 是缓冲的, 退出前写出
+    builder->CreateCall(getRuntimeFunction("pc_flush", builder->getVoidTy(), {}));
+    builder->CreateRet(builder->getInt32(0));
+
+    for (auto &def: this->defs) {
+        if (!dynamic_cast<FuncDefAST *>(def.get()) && !dynamic_cast<ProcDefAST *>(def.get()))
+            continue;
+        // 声明失败的函数没有 Function, 不生成函数体
+        if (badProtos.count(def.get()))
+            continue;
+        StatementScope scope(def->range);
+        if (!def->codeGen()) {
+            if (!options.check)
+                return logError("error in compunit", def->range);
+            failed = true;
+        }
+    }
+    if (failed)
+        return nullptr;
+
+    registerProfile();
+    if (verifyFunction(*mainFunction, &errs()))
+        return logError("invalid main function", this->range);
+    addNoAliasAttributes();
+    return mainFunction;
+}
+
+Value* TypeDefAST::codeGen() {
+    this->codeGenDump();
+    if (records.count(this->ident))
+        return logError("TYPE redefined", this->range);
+
+    Record record;
+    vector<Type*> fieldTypes;
+    for (auto &field: *this->fields) {
+        Type* ty = getType(field->type);
+        if (!ty)
+            return logError("unknown field type", field->range);
+        if (getFieldNo(record, field->ident) >= 0)
+            return logError("duplicate field name", field->range);
+        record.fieldNames.push_back(field->ident);
+        record.fieldTypes.push_back(field->type);
+        fieldTypes.push_back(ty);
+    }
+    record.type = StructType::create(*context, fieldTypes, this->ident);
+    records[this->ident] = record;
+    // 记录类型不产生值, 以其零值表示生成成功
+    return Constant::getNullValue(record.type);
+}
+
+static bool isBuiltin(const string &name);
+
+// 用户函数只在本模块内调用: internal + fastcc, 让后端自由分配寄存器并做尾调用
+static Function* createPrototype(const string &ident, Type* retType, const ParamList &params) {
+    if (functions.count(ident) || isBuiltin(ident))
+        return (Function*)logError("function redefined", statementRange);
+
+    vector<Type*> paramTypes;
+    for (auto &param: params) {
+        Type* ty = getType(param->type);
+        if (!ty)
+            return (Function*)logError("unknown parameter type", statementRange);
+        paramTypes.push_back(param->byRef ? PointerType::getUnqual(*context) : ty);
+    }
+    FunctionType* funcType = FunctionType::get(retType, paramTypes, false);
+    // 用户函数名可能与运行时符号重名, 加前缀区分
+    Function* func = Function::Create(funcType, Function::InternalLinkage, "pc." + ident, module.get());
+    func->setCallingConv(CallingConv::Fast);
+    auto param = params.begin();
+    for (auto &arg: func->args()) {
+        arg.setName((*param)->ident);
+        // BYREF 总是指向一个完整的变量, 伪代码中也无法保存这个地址
+        if ((*param)->byRef) {
+            Type* ty = getType((*param)->type);
+            const DataLayout &layout = module->getDataLayout();
+            arg.addAttr(Attribute::NoCapture);
+            arg.addAttr(Attribute::NonNull);
+            arg.addAttr(Attribute::NoUndef);
+            arg.addAttr(Attribute::getWithDereferenceableBytes(*context, layout.getTypeAllocSize(ty)));
+            arg.addAttr(Attribute::getWithAlignment(*context, layout.getABITypeAlign(ty)));
+        }
+        param++;
+    }
+    functions[ident] = { func, &params };
+    return func;
+}
+
+// 参数存入同名局部变量后生成函数体, 末尾缺少 RETURN 时返回零值
+static Function* codeGenBody(Function* func, const ParamList &params, BaseAST *block) {
+    namedValues.clear();
+    builder->SetInsertPoint(BasicBlock::Create(*context, "entry", func));
+
+    auto arg = func->arg_begin();
+    for (auto &param: params) {
+        if (param->byRef) {
+            if (namedValues.count(param->ident))
+                return (Function*)logError("variable redeclared", statementRange);
+            Symbol sym;
+            sym.addr = &*arg++;
+            sym.type = param->type;
+            namedValues[param->ident] = sym;
+            continue;
+        }
+        // BYVAL 的参数槽由 mem2reg 提升回寄存器
+        if (!param->codeGen())
+            return nullptr;
+        builder->CreateStore(&*arg++, namedValues[param->ident].addr);
+    }
+    if (!block->codeGen())
+        return nullptr;
+
+    if (!builder->GetInsertBlock()->getTerminator()) {
+        Type* retType = func->getReturnType();
+        if (retType->isVoidTy())
+            builder->CreateRetVoid();
+        else
+            builder->CreateRet(Constant::getNullValue(retType));
+    }
+    if (verifyFunction(*func, &errs()))
+        return (Function*)logError("invalid function", statementRange);
+    return func;
+}
+
+Function* FuncDefAST::codeGenProto() {
+    Type* retType = getType(this->type);
+    if (!retType)
+        return (Function*)logError("unknown return type", this->range);
+    return createPrototype(this->ident, retType, *this->params);
 }
 
 Function* FuncDefAST::codeGen() {
     this->codeGenDump();
-    return nullptr;
+    TimeTraceScope timeScope("CodeGen FUNCTION", this->ident);
+    return codeGenBody(functions[this->ident].func, *this->params, this->block.get());
+}
+
+Function* ProcDefAST::codeGenProto() {
+    return createPrototype(this->ident, builder->getVoidTy(), *this->params);
 }
 
 Function* ProcDefAST::codeGen() {
     this->codeGenDump();
-    return nullptr;
+    TimeTraceScope timeScope("CodeGen PROCEDURE", this->ident);
+    return codeGenBody(functions[this->ident].func, *this->params, this->block.get());
+}
+
+Value* ParamAST::codeGen() {
+    this->codeGenDump();
+    Symbol sym;
+    sym.type = this->type;
+    return declareSymbol(this->ident, sym);
 }
 
 Value* BlockAST::codeGen() {
     this->codeGenDump();
+    Value* last = nullptr;
+    bool failed = false;
     for (auto &stmt: *this->stmts) {
+        countStatement(stmt.get());
+        StatementScope scope(stmt->range);
         Value* ret = stmt->codeGen();
-        if (!ret)
-            return nullptr;
+        if (!ret) {
+            // --check 时跳过出错的语句, 继续检查块中其余的语句
+            if (!options.check)
+                return nullptr;
+            failed = true;
+            continue;
+        }
+        last = ret;
+    }
+    if (failed) {
+        // 块中的错误都已报告, 包含它的语句不再报告
+        statementFailed = true;
+        return nullptr;
     }
+    return last;
 }
 
 Value* NumberAST::codeGen() {
@@ -57,38 +574,420 @@ Value* NumberAST::codeGen() {
     return ConstantFP::get(*context, APFloat(this->value));
 }
 
+Value* IntAST::codeGen() {
+    this->codeGenDump();
+    return builder->getInt32(this->value);
+}
+
+Value* ExprAST::codeGenAddr() {
+    return logError("expression is not assignable", this->range);
+}
+
+Value* StringAST::codeGen() {
+    this->codeGenDump();
+    Value* data = builder->CreateGlobalStringPtr(this->value, "str");
+    return callStringFunction("pc_string_literal", { data, builder->getInt64(this->value.size()) });
+}
+
+Value* CharAST::codeGen() {
+    this->codeGenDump();
+    return builder->getInt8(this->value);
+}
+
 Value* VarExprAST::codeGen() {
     this->codeGenDump();
-    Value* V = namedValues[this->ident];
-    if (!V)
-        return logError("Unknown variable name");
+    return loadLValue(this, this->ident);
+}
+
+Value* VarExprAST::codeGenAddr() {
+    Symbol* sym = findSymbol(this->ident);
+    if (!sym)
+        return logError("Unknown variable name", this->range);
+    if (!sym->bounds.empty())
+        return logError("array used without index", this->range);
+    this->type = sym->type;
+    return sym->addr;
+}
+
+bool IndexExprAST::codeGenIndexes(vector<Value*> &idxs) {
+    Symbol* sym = findSymbol(this->ident);
+    if (!sym) {
+        logError("Unknown variable name", this->range);
+        return false;
+    }
+    if (sym->bounds.size() != this->indexes.size()) {
+        logError("wrong number of array indexes", this->range);
+        return false;
+    }
+    for (size_t i = 0; i < this->indexes.size(); i++) {
+        Value* index = this->indexes[i]->codeGen();
+        if (!index)
+            return false;
+        index = castTo(index, builder->getInt32Ty());
+        if (!index)
+            return false;
+        idxs.push_back(builder->CreateNSWSub(index, builder->getInt32(sym->bounds[i].first), "idxtmp"));
+    }
+    this->type = sym->type;
+    return true;
+}
+
+Value* IndexExprAST::codeGen() {
+    this->codeGenDump();
+    return loadLValue(this, this->ident);
+}
+
+Value* IndexExprAST::codeGenAddr() {
+    vector<Value*> idxs = { builder->getInt32(0) };
+    if (!this->codeGenIndexes(idxs))
+        return nullptr;
+    Symbol* sym = findSymbol(this->ident);
+    if (sym->soa)
+        return logError("struct-of-arrays element has no address, access one of its fields", this->range);
+    return builder->CreateInBoundsGEP(getSymbolType(*sym), sym->addr, idxs, this->ident + ".elem");
+}
+
+Value* FieldExprAST::codeGen() {
+    this->codeGenDump();
+    return loadLValue(this, this->field);
+}
+
+Value* FieldExprAST::codeGenAddr() {
+    // struct-of-arrays: List[i].pointer 即 List.pointer[i], 直接对字段数组寻址
+    auto *index = dynamic_cast<IndexExprAST *>(this->base.get());
+    Symbol* sym = index ? findSymbol(index->ident) : nullptr;
+    if (sym && sym->soa) {
+        const Record &record = records[sym->type];
+        int fieldNo = getFieldNo(record, this->field);
+        if (fieldNo < 0)
+            return logError("unknown record field", this->range);
+        vector<Value*> idxs = { builder->getInt32(0), builder->getInt32(fieldNo) };
+        if (!index->codeGenIndexes(idxs))
+            return nullptr;
+        this->type = record.fieldTypes[fieldNo];
+        return builder->CreateInBoundsGEP(getSymbolType(*sym), sym->addr, idxs, this->field + ".addr");
+    }
+
+    Value* addr = this->base->codeGenAddr();
+    if (!addr)
+        return nullptr;
+    auto record = records.find(this->base->type);
+    if (record == records.end())
+        return logError("field access on a non-record value", this->range);
+    int fieldNo = getFieldNo(record->second, this->field);
+    if (fieldNo < 0)
+        return logError("unknown record field", this->range);
+    this->type = record->second.fieldTypes[fieldNo];
+    return builder->CreateStructGEP(record->second.type, addr, fieldNo, this->field + ".addr");
+}
+
+// 字符串内置函数的实现 (runtime/string_simd.c) 不抛异常;
+// 只读写参数所指内存的可以被 LLVM 合并, 外提出循环
+static void setBuiltinAttributes(const char *name, bool argMemOnly, bool readOnly) {
+    Function* F = module->getFunction(name);
+    F->addFnAttr(Attribute::NoUnwind);
+    if (argMemOnly)
+        F->setOnlyAccessesArgMemory();
+    if (readOnly)
+        F->setOnlyReadsMemory();
+}
+
+static bool isBuiltin(const string &name) {
+    return name == "LENGTH" || name == "MID" || name == "SUBSTRING" || name == "LEFT" || name == "RIGHT"
+        || name == "UCASE" || name == "LCASE" || name == "FIND";
+}
+
+static Value* codeGenBuiltin(const string &name, vector<Value*> &args) {
+    Type* i64 = builder->getInt64Ty();
+    size_t count = name == "MID" || name == "SUBSTRING" ? 3 : name == "LEFT" || name == "RIGHT" || name == "FIND" ? 2 : 1;
+    if (args.size() != count)
+        return logError("wrong number of arguments to builtin function", statementRange);
+
+    // UCASE/LCASE 作用于 CHAR 时直接在 IR 里转换
+    if ((name == "UCASE" || name == "LCASE") && args[0]->getType()->isIntegerTy(8)) {
+        Value* c = args[0];
+        Value* offset = builder->CreateSub(c, builder->getInt8(name == "UCASE" ? 'a' : 'A'));
+        Value* isLetter = builder->CreateICmpULT(offset, builder->getInt8(26));
+        return builder->CreateSelect(isLetter, builder->CreateXor(c, builder->getInt8(0x20)), c, "casetmp");
+    }
+
+    args[0] = castTo(args[0], stringType);
+    if (!args[0])
+        return nullptr;
+    Value* str = stringAddr(args[0]);
+
+    if (name == "LENGTH") {
+        Value* V = builder->CreateCall(getRuntimeFunction("pc_length", i64, { str->getType() }), { str }, "length");
+        setBuiltinAttributes("pc_length", true, true);
+        return castTo(V, builder->getInt32Ty());
+    }
+    if (name == "FIND") {
+        const char *func = args[1]->getType()->isIntegerTy(8) ? "pc_find_char" : "pc_find";
+        Value* needle = args[1];
+        if (needle->getType() != builder->getInt8Ty()) {
+            needle = castTo(needle, stringType);
+            if (!needle)
+                return nullptr;
+            needle = stringAddr(needle);
+        }
+        Value* V = builder->CreateCall(getRuntimeFunction(func, i64, { str->getType(), needle->getType() }), { str, needle }, "pos");
+        // 通过全局的 findChar 函数指针按 CPU 分派, 读全局变量, 不是 argmemonly
+        setBuiltinAttributes(func, false, true);
+        return castTo(V, builder->getInt32Ty());
+    }
+    if (name == "UCASE" || name == "LCASE") {
+        const char *func = name == "UCASE" ? "pc_ucase" : "pc_lcase";
+        Value* V = callStringFunction(func, { str });
+        setBuiltinAttributes(func, false, false);
+        return V;
+    }
+
+    // MID/SUBSTRING(s, start, length), LEFT/RIGHT(s, length)
+    const char *func = name == "LEFT" ? "pc_left" : name == "RIGHT" ? "pc_right" : "pc_mid";
+    vector<Value*> callArgs = { str };
+    for (size_t i = 1; i < args.size(); i++) {
+        Value* V = castTo(args[i], i64);
+        if (!V)
+            return nullptr;
+        callArgs.push_back(V);
+    }
+    Value* V = callStringFunction(func, callArgs);
+    // 源字符串的字节经 heap.data 读取, 在 arena 或常量区中, 不是参数所指的内存
+    setBuiltinAttributes(func, false, false);
     return V;
 }
 
+// 调用用户定义的 FUNCTION (表达式中) 或 PROCEDURE (CALL 语句)
+static Value* codeGenCall(const string &ident, const ExprList &exprs, bool isProcedure) {
+    auto it = functions.find(ident);
+    if (it == functions.end())
+        return logError("Unknown function referenced", statementRange);
+    Function* callee = it->second.func;
+    const ParamList &params = *it->second.params;
+    if (callee->getReturnType()->isVoidTy() != isProcedure)
+        return logError(isProcedure ? "CALL of a FUNCTION" : "PROCEDURE used as a value", statementRange);
+    if (params.size() != exprs.size())
+        return logError("Incorrect # arguments passed", statementRange);
+
+    vector<Value*> args;
+    for (unsigned i = 0; i < exprs.size(); i++) {
+        Value* V;
+        if (params[i]->byRef) {
+            // BYREF 传变量的地址, 类型必须一致
+            V = exprs[i]->codeGenAddr();
+            if (!V)
+                return logError("BYREF argument must be a variable", statementRange);
+            if (exprs[i]->type != params[i]->type)
+                return logError("BYREF argument type mismatch", statementRange);
+        } else {
+            V = exprs[i]->codeGen();
+            if (!V)
+                return nullptr;
+            V = castTo(V, callee->getFunctionType()->getParamType(i));
+            if (!V)
+                return nullptr;
+        }
+        args.push_back(V);
+    }
+    CallInst* call = builder->CreateCall(callee, args);
+    call->setCallingConv(CallingConv::Fast);
+    return call;
+}
+
+Value* CallExprAST::codeGen() {
+    this->codeGenDump();
+    if (functions.count(this->ident))
+        return codeGenCall(this->ident, this->args, false);
+
+    vector<Value*> args;
+    for (auto &arg: this->args) {
+        Value* V = arg->codeGen();
+        if (!V)
+            return nullptr;
+        args.push_back(V);
+    }
+    if (isBuiltin(this->ident))
+        return codeGenBuiltin(this->ident, args);
+    return logError("Unknown function referenced", this->range);
+}
+
+Value* CallAST::codeGen() {
+    this->codeGenDump();
+    return codeGenCall(this->ident, this->args, true);
+}
+
 Value* PrimaryExprAST::codeGen() {
     this->codeGenDump();
     return expr->codeGen();
 }
 
+Value* PrimaryExprAST::codeGenAddr() {
+    Value* addr = expr->codeGenAddr();
+    this->type = expr->type;
+    return addr;
+}
+
+// 条件必须是 BOOLEAN (整数按非零处理), 结果为 i1, 可直接用于条件跳转
+static Value* codeGenCond(BaseAST *cond) {
+    Value* V = cond->codeGen();
+    if (!V)
+        return nullptr;
+    if (!V->getType()->isIntegerTy())
+        return logError("condition must be BOOLEAN", statementRange);
+    return castTo(V, builder->getInt1Ty());
+}
+
+// AND/OR 短路求值: 左操作数已经决定结果时不计算右操作数
+static Value* codeGenLogical(const string &op, BaseAST *lhs, BaseAST *rhs) {
+    bool isAnd = op == "AND";
+    Value* L = codeGenCond(lhs);
+    if (!L)
+        return nullptr;
+
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* lhsBB = builder->GetInsertBlock();
+    BasicBlock* rhsBB = BasicBlock::Create(*context, isAnd ? "and.rhs" : "or.rhs", func);
+    BasicBlock* endBB = BasicBlock::Create(*context, isAnd ? "and.end" : "or.end", func);
+    if (isAnd)
+        builder->CreateCondBr(L, rhsBB, endBB);
+    else
+        builder->CreateCondBr(L, endBB, rhsBB);
+
+    builder->SetInsertPoint(rhsBB);
+    Value* R = codeGenCond(rhs);
+    if (!R)
+        return nullptr;
+    // 右操作数中可能还有短路求值, 取其结束所在的基本块
+    rhsBB = builder->GetInsertBlock();
+    builder->CreateBr(endBB);
+
+    builder->SetInsertPoint(endBB);
+    PHINode* phi = builder->CreatePHI(builder->getInt1Ty(), 2, "booltmp");
+    phi->addIncoming(builder->getInt1(!isAnd), lhsBB);
+    phi->addIncoming(R, rhsBB);
+    return phi;
+}
+
+// 比较的结果为 i1; STRING 按 pc_string_compare 的结果与 0 比较
+static Value* codeGenCompare(const string &op, Value* L, Value* R) {
+    if (L->getType() == stringType || R->getType() == stringType) {
+        L = castTo(L, stringType);
+        R = castTo(R, stringType);
+        if (!L || !R)
+            return nullptr;
+        Type* ptrTy = PointerType::getUnqual(*context);
+        FunctionCallee compare = getRuntimeFunction("pc_string_compare", builder->getInt32Ty(), { ptrTy, ptrTy });
+        L = builder->CreateCall(compare, { stringAddr(L), stringAddr(R) }, "cmptmp");
+        R = builder->getInt32(0);
+        // memcmp 两个字符串在 arena 或常量区中的内容, 只读但不是 argmemonly
+        setBuiltinAttributes("pc_string_compare", false, true);
+    }
+
+    if (L->getType()->isFloatingPointTy() || R->getType()->isFloatingPointTy()) {
+        L = castTo(L, builder->getDoubleTy());
+        R = castTo(R, builder->getDoubleTy());
+        if (!L || !R)
+            return nullptr;
+        CmpInst::Predicate pred;
+        if (op == "=")
+            pred = CmpInst::FCMP_OEQ;
+        else if (op == "<>")
+            pred = CmpInst::FCMP_UNE;
+        else if (op == "<")
+            pred = CmpInst::FCMP_OLT;
+        else if (op == ">")
+            pred = CmpInst::FCMP_OGT;
+        else if (op == "<=")
+            pred = CmpInst::FCMP_OLE;
+        else
+            pred = CmpInst::FCMP_OGE;
+        return builder->CreateFCmp(pred, L, R, "cmptmp");
+    }
+
+    if (!L->getType()->isIntegerTy() || !R->getType()->isIntegerTy())
+        return logError("invalid operands to comparison", statementRange);
+    if (L->getType() != R->getType()) {
+        L = castTo(L, builder->getInt32Ty());
+        R = castTo(R, builder->getInt32Ty());
+    }
+    // CHAR 与 BOOLEAN 按无符号比较
+    bool isSigned = L->getType()->getIntegerBitWidth() > 8;
+    CmpInst::Predicate pred;
+    if (op == "=")
+        pred = CmpInst::ICMP_EQ;
+    else if (op == "<>")
+        pred = CmpInst::ICMP_NE;
+    else if (op == "<")
+        pred = isSigned ? CmpInst::ICMP_SLT : CmpInst::ICMP_ULT;
+    else if (op == ">")
+        pred = isSigned ? CmpInst::ICMP_SGT : CmpInst::ICMP_UGT;
+    else if (op == "<=")
+        pred = isSigned ? CmpInst::ICMP_SLE : CmpInst::ICMP_ULE;
+    else
+        pred = isSigned ? CmpInst::ICMP_SGE : CmpInst::ICMP_UGE;
+    return builder->CreateICmp(pred, L, R, "cmptmp");
+}
+
+// INTEGER 之间的 + - * MOD 是整数运算, 有 REAL 参与或 / 时是实数运算
+static Value* codeGenArith(const string &op, Value* L, Value* R) {
+    if (op == "/" || L->getType()->isFloatingPointTy() || R->getType()->isFloatingPointTy()) {
+        L = castTo(L, builder->getDoubleTy());
+        R = castTo(R, builder->getDoubleTy());
+        if (!L || !R)
+            return nullptr;
+        if (op == "+")
+            return builder->CreateFAdd(L, R, "addtmp");
+        else if (op == "-")
+            return builder->CreateFSub(L, R, "subtmp");
+        else if (op == "*")
+            return builder->CreateFMul(L, R, "multmp");
+        else if (op == "/")
+            return builder->CreateFDiv(L, R, "divtmp");
+        else
+            return builder->CreateFRem(L, R, "modtmp");
+    }
+
+    if (!L->getType()->isIntegerTy() || !R->getType()->isIntegerTy())
+        return logError("invalid operands to arithmetic operator", statementRange);
+    L = castTo(L, builder->getInt32Ty());
+    R = castTo(R, builder->getInt32Ty());
+    if (op == "+")
+        return builder->CreateAdd(L, R, "addtmp");
+    else if (op == "-")
+        return builder->CreateSub(L, R, "subtmp");
+    else if (op == "*")
+        return builder->CreateMul(L, R, "multmp");
+    else
+        return builder->CreateSRem(L, R, "modtmp");
+}
+
 Value* BinaryExprAST::codeGen() {
     this->codeGenDump();
+    if (this->op == "AND" || this->op == "OR")
+        return codeGenLogical(this->op, this->lhs.get(), this->rhs.get());
+
     Value* L = this->lhs->codeGen();
     if (!L)
-        return logError("invalid right hand side binary operation");
+        return logError("invalid right hand side binary operation", this->range);
     Value* R = this->rhs->codeGen();
     if (!R)
-        return logError("invalid right hand side binary operation");
-    
-    if (this->op == "+")
-        return builder->CreateFAdd(L, R, "addtmp");
-    else if (this->op == "-")
-        return builder->CreateFSub(L, R, "subtmp");
-    else if (this->op == "*")
-        return builder->CreateFMul(L, R, "multmp");
-    else if (this->op == "/")
-        return builder->CreateFDiv(L, R, "divtmp");
+        return logError("invalid right hand side binary operation", this->range);
+
+    if (this->op == "&") {
+        L = castTo(L, stringType);
+        R = castTo(R, stringType);
+        if (!L || !R)
+            return logError("& needs STRING or CHAR operands", this->range);
+        return callStringFunction("pc_string_concat", { stringAddr(L), stringAddr(R) });
+    }
+
+    if (this->op == "+" || this->op == "-" || this->op == "*" || this->op == "/" || this->op == "MOD")
+        return codeGenArith(this->op, L, R);
+    else if (this->op == "=" || this->op == "<>" || this->op == "<" || this->op == ">"
+             || this->op == "<=" || this->op == ">=")
+        return codeGenCompare(this->op, L, R);
     else
-        return logError("invalid binary operator");
+        return logError("invalid binary operator", this->range);
 }
 
 
@@ -98,43 +997,235 @@ Value* UnaryExprAST::codeGen() {
     if (!Operand)
         return nullptr;
 
+    Type* ty = Operand->getType();
     if (this->op == "+")
         return Operand;
-    else if (this->op == "-")
+    else if (this->op == "-" && ty->isFloatingPointTy())
         return builder->CreateFNeg(Operand, "negtmp");
+    else if (this->op == "-" && ty->isIntegerTy())
+        return builder->CreateNeg(castTo(Operand, builder->getInt32Ty()), "negtmp");
+    else if (this->op == "NOT" && ty->isIntegerTy())
+        return builder->CreateNot(castTo(Operand, builder->getInt1Ty()), "nottmp");
     else
-        return logError("invalid unary operator");
+        return logError("invalid unary operator", this->range);
 }
 
 Value* VarDeclAST::codeGen() {
     this->codeGenDump();
+    Symbol sym;
+    sym.type = this->type;
+    return declareSymbol(this->ident, sym);
+}
+
+Value* ArrDeclAST::codeGen() {
+    this->codeGenDump();
+    for (auto &bound: this->bounds) {
+        if (bound.first > bound.second)
+            return logError("array lower bound greater than upper bound", this->range);
+    }
+    Symbol sym;
+    sym.type = this->type;
+    sym.bounds = this->bounds;
+    sym.soa = options.soa && records.count(this->type);
+    return declareSymbol(this->ident, sym);
 }
 
 Value* VarAssignAST::codeGen() {
     this->codeGenDump();
-    Value* V = namedValues[this->ident];
+    Value* V = this->lval->codeGenAddr();
     if (!V)
-        return logError("Unknown variable name");
+        return logError("invalid left hand side of assignment", this->range);
 
     Value* R = this->expr->codeGen();
     if (!R)
-        return logError("invalid right hand side binary operation");
+        return logError("invalid right hand side binary operation", this->range);
+    R = castTo(R, getType(this->lval->type));
+    if (!R)
+        return nullptr;
 
     builder->CreateStore(R, V);
     return R;
 }
 
 Value* IfAST::codeGen() {
+    this->codeGenDump();
+    Value* cond = codeGenCond(this->cond.get());
+    if (!cond)
+        return nullptr;
+
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* thenBB = BasicBlock::Create(*context, "then", func);
+    BasicBlock* elseBB = this->hasElse ? BasicBlock::Create(*context, "else", func) : nullptr;
+    BasicBlock* mergeBB = BasicBlock::Create(*context, "ifcont", func);
+    Value* br = builder->CreateCondBr(cond, thenBB, elseBB ? elseBB : mergeBB);
+
+    builder->SetInsertPoint(thenBB);
+    if (!this->block->codeGen())
+        return nullptr;
+    builder->CreateBr(mergeBB);
+
+    if (elseBB) {
+        builder->SetInsertPoint(elseBB);
+        if (!this->elseBlock->codeGen())
+            return nullptr;
+        builder->CreateBr(mergeBB);
+    }
+
+    builder->SetInsertPoint(mergeBB);
+    return br;
 }
 
 Value* WhileAST::codeGen() {
+    this->codeGenDump();
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* condBB = BasicBlock::Create(*context, "whilecond", func);
+    BasicBlock* bodyBB = BasicBlock::Create(*context, "whilebody", func);
+    BasicBlock* endBB = BasicBlock::Create(*context, "whileend", func);
+    builder->CreateBr(condBB);
+
+    builder->SetInsertPoint(condBB);
+    Value* cond = codeGenCond(this->cond.get());
+    if (!cond)
+        return nullptr;
+    Value* br = builder->CreateCondBr(cond, bodyBB, endBB);
+
+    builder->SetInsertPoint(bodyBB);
+    if (!this->block->codeGen())
+        return nullptr;
+    builder->CreateBr(condBB);
+
+    builder->SetInsertPoint(endBB);
+    return br;
 }
 
+// FOR i <- a TO b: a 与 b 只求值一次, i 未声明时隐式声明为 INTEGER
 Value* ForAST::codeGen() {
+    this->codeGenDump();
+    Symbol* sym = findSymbol(this->ident);
+    if (!sym) {
+        Symbol var;
+        var.type = "INTEGER";
+        if (!declareSymbol(this->ident, var))
+            return nullptr;
+        sym = findSymbol(this->ident);
+    }
+    if (sym->type != "INTEGER" || !sym->bounds.empty())
+        return logError("FOR variable must be INTEGER", this->range);
+    Value* addr = sym->addr;
+
+    Type* intTy = builder->getInt32Ty();
+    Value* from = this->exprFrom->codeGen();
+    if (!from || !(from = castTo(from, intTy)))
+        return nullptr;
+    Value* to = this->exprTo->codeGen();
+    if (!to || !(to = castTo(to, intTy)))
+        return nullptr;
+    builder->CreateStore(from, addr);
+
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* condBB = BasicBlock::Create(*context, "forcond", func);
+    BasicBlock* bodyBB = BasicBlock::Create(*context, "forbody", func);
+    BasicBlock* endBB = BasicBlock::Create(*context, "forend", func);
+    builder->CreateBr(condBB);
+
+    builder->SetInsertPoint(condBB);
+    Value* i = builder->CreateLoad(intTy, addr, this->ident);
+    Value* br = builder->CreateCondBr(builder->CreateICmpSLE(i, to, "forcmp"), bodyBB, endBB);
+
+    builder->SetInsertPoint(bodyBB);
+    if (!this->block->codeGen())
+        return nullptr;
+    i = builder->CreateLoad(intTy, addr, this->ident);
+    builder->CreateStore(builder->CreateAdd(i, builder->getInt32(1), "nextvar"), addr);
+    builder->CreateBr(condBB);
+
+    builder->SetInsertPoint(endBB);
+    return br;
 }
 
 Value* ReturnAST::codeGen() {
+    this->codeGenDump();
+    Function* func = builder->GetInsertBlock()->getParent();
+    Type* retType = func->getReturnType();
+    if (func == mainFunction || retType->isVoidTy())
+        return logError("RETURN outside FUNCTION", this->range);
+
+    Value* V = this->expr->codeGen();
+    if (!V)
+        return nullptr;
+    V = castTo(V, retType);
+    if (!V)
+        return nullptr;
+
+    // RETURN f(...) 直接递归调用自身时保证是尾调用, -O0 下也不会增长栈,
+    // 优化时 tailcallelim 再把它变成循环
+    // 但 BYREF 传入本函数的局部变量时, 被调用者要访问当前栈帧, 不能尾调用
+    auto *call = dyn_cast<CallInst>(V);
+    bool usesFrame = false;
+    if (call) {
+        for (Value* arg: call->args())
+            usesFrame |= isa<AllocaInst>(getUnderlyingObject(arg));
+    }
+    if (call && !usesFrame && call->getCalledFunction() == func)
+        call->setTailCallKind(CallInst::TCK_MustTail);
+    else if (call && !usesFrame && call->getCallingConv() == CallingConv::Fast)
+        call->setTailCallKind(CallInst::TCK_Tail);
+
+    Value* ret = builder->CreateRet(V);
+    // RETURN 之后的语句不可达, 生成在新的基本块中
+    builder->SetInsertPoint(BasicBlock::Create(*context, "afterret", func));
+    return ret;
 }
 
 Value* OutputAST::codeGen() {
+    this->codeGenDump();
+    Value* V = this->expr->codeGen();
+    if (!V)
+        return nullptr;
+
+    Type* voidTy = builder->getVoidTy();
+    Type* ty = V->getType();
+    if (ty->isIntegerTy(1)) {
+        V = builder->CreateZExt(V, builder->getInt32Ty());
+        builder->CreateCall(getRuntimeFunction("pc_output_bool", voidTy, { builder->getInt32Ty() }), { V });
+    } else if (ty->isIntegerTy(8)) {
+        builder->CreateCall(getRuntimeFunction("pc_output_char", voidTy, { ty }), { V });
+    } else if (ty->isIntegerTy()) {
+        V = builder->CreateSExt(V, builder->getInt64Ty());
+        builder->CreateCall(getRuntimeFunction("pc_output_int", voidTy, { builder->getInt64Ty() }), { V });
+    } else if (ty->isDoubleTy()) {
+        builder->CreateCall(getRuntimeFunction("pc_output_real", voidTy, { ty }), { V });
+    } else if (ty == stringType) {
+        V = stringAddr(V);
+        builder->CreateCall(getRuntimeFunction("pc_output_string", voidTy, { V->getType() }), { V });
+    } else {
+        return logError("value cannot be output", this->range);
+    }
+    return builder->CreateCall(getRuntimeFunction("pc_output_newline", voidTy, {}));
+}
+
+Value* InputAST::codeGen() {
+    this->codeGenDump();
+    Value* addr = this->lval->codeGenAddr();
+    if (!addr)
+        return nullptr;
+
+    Type* ty = getType(this->lval->type);
+    Value* V;
+    if (ty->isIntegerTy(1))
+        V = builder->CreateCall(getRuntimeFunction("pc_input_bool", builder->getInt32Ty(), {}), {}, "input");
+    else if (ty->isIntegerTy(8))
+        V = builder->CreateCall(getRuntimeFunction("pc_input_char", ty, {}), {}, "input");
+    else if (ty->isIntegerTy())
+        V = builder->CreateCall(getRuntimeFunction("pc_input_int", builder->getInt64Ty(), {}), {}, "input");
+    else if (ty->isDoubleTy())
+        V = builder->CreateCall(getRuntimeFunction("pc_input_real", ty, {}), {}, "input");
+    else if (ty == stringType)
+        V = callStringFunction("pc_input_string", {});
+    else
+        return logError("value cannot be input", this->range);
+
+    V = castTo(V, ty);
+    builder->CreateStore(V, addr);
+    return V;
 }
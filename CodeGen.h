@@ -29,17 +29,58 @@
 #include <string>
 #include <vector>
 #include "AST.h"
+#include "Options.h"
 #include "parser.tab.hpp"
 
 using namespace llvm;
 using namespace std;
 
-static unique_ptr<LLVMContext> context;
-static unique_ptr<Module> module;
-static unique_ptr<IRBuilder<>> builder;
-static map<string, Value*> namedValues;
-static unique_ptr<legacy::FunctionPassManager> fpm;
+// 以下全局状态每个线程一份, --batch 时各线程独立生成各自的 Module
+static thread_local unique_ptr<LLVMContext> context;
+static thread_local unique_ptr<Module> module;
+static thread_local unique_ptr<IRBuilder<>> builder;
+
+// 变量的地址及类型
+struct Symbol {
+    Value* addr = nullptr;
+    // 标量或记录的类型名, 数组为元素类型名
+    string type;
+    // 数组各维 (下界, 上界), 非数组为空
+    BoundList bounds;
+    // ARRAY OF <record> 按 struct-of-arrays 布局
+    bool soa = false;
+};
+
+// TYPE ... ENDTYPE 定义的记录
+struct Record {
+    StructType* type;
+    vector<string> fieldNames;
+    vector<string> fieldTypes;
+};
+
+static thread_local map<string, Symbol> namedValues;
+// 顶层 DECLARE 的变量, 所有过程可见
+static thread_local map<string, Symbol> globalValues;
+static thread_local map<string, Record> records;
+// 顶层语句生成在 main 中
+static thread_local Function* mainFunction;
+// 用户定义的 FUNCTION/PROCEDURE
+struct Routine {
+    Function* func;
+    // 调用时按参数的类型名和传递方式检查实参
+    const ParamList* params;
+};
+
+// 不与运行时或 main 的符号名混在一起查找
+static thread_local map<string, Routine> functions;
+// STRING 的值, 布局见 runtime/runtime.h 中的 pc_string
+static thread_local StructType* stringType;
+static thread_local unique_ptr<legacy::FunctionPassManager> fpm;
+// --profile: 计数器数组 (生成结束时才知道长度, 先用占位的全局变量), 以及每个计数器对应的行
+static thread_local GlobalVariable* profileCounters;
+static thread_local vector<int32_t> profileLines;
+// 正在生成的源文件, 把语句的偏移换算成行号
+static thread_local const SourceFile* sourceFile;
 
-Value* logError(const char *str);
 
 #endif
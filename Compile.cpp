@@ -0,0 +1,79 @@
+#include "Compile.h"
+#include <mutex>
+#include "Backend.h"
+#include "Memoize.h"
+#include "Options.h"
+#include "Source.h"
+#include "Stats.h"
+
+extern int yyparse(unique_ptr<BaseAST> &ast);
+extern void resetScanner(const char *text, size_t size);
+extern int parseErrors;
+extern const SourceFile *parseSource;
+
+// 保护 flex/bison 的全局状态 (扫描缓冲, 当前偏移, 记号的值和位置)
+static mutex parserMutex;
+
+unique_ptr<BaseAST> parseFile(const string &path) {
+    // 编辑器可以把未保存的内容经 stdin 传进来
+    auto source = make_unique<SourceFile>();
+    if (!source->load(path)) {
+        *diagnostics << "error: cannot open " << path << endl;
+        return nullptr;
+    }
+    unique_ptr<BaseAST> ast;
+    int ret;
+    {
+        lock_guard<mutex> lock(parserMutex);
+        PhaseTimer timer(PHASE_PARSE);
+        resetScanner(source->text().data(), source->text().size());
+        parseSource = source.get();
+        parseErrors = 0;
+        ret = yyparse(ast);
+        // 从错误中恢复后 yyparse 仍返回 0, AST 不完整
+        if (parseErrors)
+            ret = 1;
+        parseSource = nullptr;
+    }
+    if (ret)
+        return nullptr;
+    // 代码生成时把节点的偏移换算成行号
+    static_cast<CompUnitAST *>(ast.get())->source = std::move(source);
+    return ast;
+}
+
+bool checkFile(const string &path, bool semantic) {
+    unique_ptr<BaseAST> ast = parseFile(path);
+    if (!ast)
+        return false;
+    if (!semantic)
+        return true;
+    bool ok;
+    {
+        PhaseTimer timer(PHASE_SEMANTIC);
+        ok = ast->codeGen() != nullptr;
+    }
+    takeModule();
+    return ok;
+}
+
+bool generateModule(BaseAST &ast) {
+    {
+        PhaseTimer timer(PHASE_IRGEN);
+        if (!ast.codeGen())
+            return false;
+    }
+    Module* module = getModule();
+    if (options.memoize) {
+        PhaseTimer timer(PHASE_OPTIMIZE);
+        memoizeFunctions(*module);
+    }
+    if (options.runtime) {
+        PhaseTimer timer(PHASE_LINK);
+        if (!linkRuntime(*module))
+            return false;
+    }
+    PhaseTimer timer(PHASE_OPTIMIZE);
+    optimizeModule(*module, options.optLevel);
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef __COMPILE_H__
+#define __COMPILE_H__
+
+// 一个源文件从解析到优化的流水线, 命令行与 --batch 共用
+
+#include <memory>
+#include <string>
+#include "AST.h"
+
+using namespace std;
+
+// 解析 path ("-" 为 stdin), 出错返回 nullptr. 语法分析器不可重入, 多个线程同时调用时依次执行
+unique_ptr<BaseAST> parseFile(const string &path);
+
+// --syntax-only/--check: 解析 path, check 时再做语义检查, 返回是否没有错误.
+// 语义检查就是生成 IR (类型和名字的错误在代码生成时报告), 但不链接运行时, 不优化,
+// 也不初始化 LLVM 的目标, 生成的 Module 随即丢弃
+bool checkFile(const string &path, bool semantic);
+
+// 为 ast 生成本线程的 Module, 再按 options 做 --memoize, 链接运行时和优化;
+// 结果用 getModule/takeModule 取得
+bool generateModule(BaseAST &ast);
+
+#endif
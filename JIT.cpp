@@ -0,0 +1,191 @@
+#include "JIT.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/raw_ostream.h"
+#include "AST.h"
+#include "Backend.h"
+#include "Cache.h"
+#include "Options.h"
+#include "Stats.h"
+
+// 运行时里 __builtin_cpu_supports 读取的 __cpu_model 来自 libgcc/compiler-rt 的静态库,
+// atexit 来自 libc_nonshared.a, 都不在进程的动态符号表中, JIT 代码改用编译器自己的这一份
+extern "C" char __cpu_model[];
+
+// perf 的约定: /tmp/perf-<pid>.map 每行 "起始地址 大小 名字" (十六进制)
+class PerfMapListener : public JITEventListener {
+    FILE *file;
+
+public:
+    PerfMapListener() {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+        file = fopen(path, "w");
+        if (!file)
+            logError("cannot open perf map");
+    }
+
+    ~PerfMapListener() override {
+        if (file)
+            fclose(file);
+    }
+
+    void notifyObjectLoaded(ObjectKey key, const object::ObjectFile &obj,
+                            const RuntimeDyld::LoadedObjectInfo &info) override {
+        if (!file)
+            return;
+        // 调试用的副本中各节已经是加载后的地址
+        object::OwningBinary<object::ObjectFile> debugObj = info.getObjectForDebug(obj);
+        if (!debugObj.getBinary())
+            return;
+        for (auto &symbolSize: object::computeSymbolSizes(*debugObj.getBinary())) {
+            object::SymbolRef symbol = symbolSize.first;
+            Expected<object::SymbolRef::Type> type = symbol.getType();
+            Expected<StringRef> name = symbol.getName();
+            Expected<uint64_t> address = symbol.getAddress();
+            if (!type || !name || !address || *type != object::SymbolRef::ST_Function || !symbolSize.second) {
+                consumeError(type.takeError());
+                consumeError(name.takeError());
+                consumeError(address.takeError());
+                continue;
+            }
+            fprintf(file, "%llx %llx %.*s\n", (unsigned long long)*address, (unsigned long long)symbolSize.second,
+                    (int)name->size(), name->data());
+        }
+        fflush(file);
+    }
+};
+
+// --cache 时 JIT 生成的目标文件以 module 的 IR 和目标机器为键存入磁盘缓存,
+// 再次运行同一个程序时跳过机器码生成
+class JITObjectCache : public ObjectCache {
+    // JIT 的目标机器, 见 targetDescription
+    string target;
+    // getObject 未命中时记下键, notifyObjectCompiled 时使用
+    DenseMap<const Module*, string> keys;
+
+public:
+    explicit JITObjectCache(const TargetMachine &targetMachine)
+        : target(targetDescription(targetMachine)) {}
+
+    unique_ptr<MemoryBuffer> getObject(const Module *module) override {
+        // bitcode 中符号表的顺序随散列表而变, 文本形式的 IR 才是确定的
+        string text;
+        raw_string_ostream out(text);
+        module->print(out, nullptr);
+        string key = cacheKeyOf("jit " + target, out.str());
+        if (unique_ptr<MemoryBuffer> object = cacheLookup(key))
+            return object;
+        keys[module] = key;
+        return nullptr;
+    }
+
+    void notifyObjectCompiled(const Module *module, MemoryBufferRef object) override {
+        auto it = keys.find(module);
+        if (it == keys.end())
+            return;
+        cacheStore(it->second, object.getBuffer());
+        keys.erase(it);
+    }
+};
+
+static MainFunction jitError(Error err) {
+    errs() << toString(std::move(err)) << "\n";
+    logError("JIT failed");
+    return nullptr;
+}
+
+MainFunction compileJIT(unique_ptr<LLVMContext> context, unique_ptr<Module> module) {
+    PhaseTimer jitTimer(PHASE_JIT);
+    // 同时初始化本机目标; 生成的代码与 --run 时的优化一样针对本机 CPU
+    if (!getTargetMachine())
+        return nullptr;
+
+    vector<JITEventListener*> listeners;
+    if (options.perf) {
+        // 没有以 LLVM_USE_PERF 构建的 LLVM 返回 nullptr, 只输出 perf map
+        if (JITEventListener* jitdump = JITEventListener::createPerfJITEventListener())
+            listeners.push_back(jitdump);
+        listeners.push_back(new PerfMapListener());
+    }
+
+    unique_ptr<JITObjectCache> objectCache;
+    // 显式使用 RuntimeDyld, 事件监听器只挂在这一层上
+    auto jit = orc::LLJITBuilder()
+        .setCompileFunctionCreator([&](orc::JITTargetMachineBuilder builder)
+                                       -> Expected<unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+            auto targetMachine = builder.createTargetMachine();
+            if (!targetMachine)
+                return targetMachine.takeError();
+            // 不用磁盘缓存时没有可复用的目标文件, 也就不必打印 IR 计算键
+            if (options.cache)
+                objectCache = make_unique<JITObjectCache>(**targetMachine);
+            return make_unique<orc::TMOwningSimpleCompiler>(std::move(*targetMachine), objectCache.get());
+        })
+        .setObjectLinkingLayerCreator([&](orc::ExecutionSession &session, const Triple &) {
+            auto layer = make_unique<orc::RTDyldObjectLinkingLayer>(session, []() {
+                return make_unique<SectionMemoryManager>();
+            });
+            for (JITEventListener* listener: listeners)
+                layer->registerJITEventListener(*listener);
+            return layer;
+        })
+        .create();
+    if (!jit)
+        return jitError(jit.takeError());
+
+    orc::JITDylib &dylib = (*jit)->getMainJITDylib();
+    char prefix = (*jit)->getDataLayout().getGlobalPrefix();
+    auto process = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(prefix);
+    if (!process)
+        return jitError(process.takeError());
+    dylib.addGenerator(std::move(*process));
+
+    orc::MangleAndInterner mangle((*jit)->getExecutionSession(), (*jit)->getDataLayout());
+    __builtin_cpu_init();
+    orc::SymbolMap hostSymbols;
+    hostSymbols[mangle("atexit")] = JITEvaluatedSymbol(pointerToJITTargetAddress(&atexit), JITSymbolFlags::Exported);
+    hostSymbols[mangle("__cpu_model")] = JITEvaluatedSymbol(pointerToJITTargetAddress(__cpu_model), JITSymbolFlags::Exported);
+    if (Error err = dylib.define(orc::absoluteSymbols(std::move(hostSymbols))))
+        return jitError(std::move(err));
+
+    if (Error err = (*jit)->addIRModule(orc::ThreadSafeModule(std::move(module), std::move(context))))
+        return jitError(std::move(err));
+    // 运行时的全局构造函数 (选择 SIMD 实现等)
+    if (Error err = (*jit)->initialize(dylib))
+        return jitError(std::move(err));
+    auto mainSymbol = (*jit)->lookup("main");
+    if (!mainSymbol)
+        return jitError(mainSymbol.takeError());
+
+#if LLVM_VERSION_MAJOR >= 15
+    auto mainFunction = mainSymbol->toPtr<MainFunction>();
+#else
+    auto mainFunction = (MainFunction)mainSymbol->getAddress();
+#endif
+
+    // 程序用 atexit 登记的函数 (--profile, --memoize 的报告) 在 JIT 生成的代码中,
+    // 进程退出前不能释放这些代码 (以及 JIT 引用的缓存)
+    jit->release();
+    objectCache.release();
+    return mainFunction;
+}
+
+bool runJIT(unique_ptr<LLVMContext> context, unique_ptr<Module> module, int &exitCode) {
+    MainFunction mainFunction = compileJIT(std::move(context), std::move(module));
+    if (!mainFunction)
+        return false;
+    PhaseTimer timer(PHASE_EXECUTE);
+    exitCode = mainFunction();
+    return true;
+}
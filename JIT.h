@@ -0,0 +1,23 @@
+#ifndef __JIT_H__
+#define __JIT_H__
+
+// --run: 不生成文件, 用 ORC LLJIT 在编译器进程中执行生成的程序
+
+#include <memory>
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+using namespace std;
+using namespace llvm;
+
+typedef int (*MainFunction)();
+
+// 生成机器码并执行全局构造函数, 返回程序的 main; 生成的代码在进程退出前一直有效.
+// --tests 在此之后为每个测试 fork 一个子进程执行 main
+MainFunction compileJIT(unique_ptr<LLVMContext> context, unique_ptr<Module> module);
+
+// 执行 module 的 main, 返回值写入 exitCode. --perf 时把 JIT 生成的函数报告给 perf:
+// /tmp/perf-<pid>.map 供 perf report 解析地址, jitdump 供 perf inject --jit 使用
+bool runJIT(unique_ptr<LLVMContext> context, unique_ptr<Module> module, int &exitCode);
+
+#endif
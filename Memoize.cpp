@@ -0,0 +1,181 @@
+#include "Memoize.h"
+#include <iostream>
+#include <set>
+#include <vector>
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "AST.h"
+
+using namespace std;
+
+// 用户定义的 FUNCTION 都是 internal fastcc, 名为 pc.<ident>
+static bool isUserFunction(const Function &func) {
+    return !func.isDeclaration() && func.hasInternalLinkage()
+        && func.getCallingConv() == CallingConv::Fast && func.getName().startswith("pc.");
+}
+
+// 结果能放进 64 位, 参数全部是 BYVAL 的 INTEGER
+static bool hasMemoSignature(const Function &func) {
+    Type* retType = func.getReturnType();
+    if (!retType->isIntegerTy() && !retType->isDoubleTy())
+        return false;
+    if (func.arg_empty())
+        return false;
+    for (auto &arg: func.args()) {
+        if (!arg.getType()->isIntegerTy(32))
+            return false;
+    }
+    return true;
+}
+
+static bool isLocal(const Value* ptr) {
+    return isa<AllocaInst>(getUnderlyingObject(ptr));
+}
+
+// 只读写自己的局部变量, 只调用 pure 中的函数
+static bool onlyTouchesLocals(const Function &func, const set<const Function*> &pure) {
+    for (auto &block: func) {
+        for (auto &inst: block) {
+            if (auto *load = dyn_cast<LoadInst>(&inst)) {
+                if (!isLocal(load->getPointerOperand()))
+                    return false;
+            } else if (auto *store = dyn_cast<StoreInst>(&inst)) {
+                if (!isLocal(store->getPointerOperand()))
+                    return false;
+            } else if (auto *memset = dyn_cast<MemSetInst>(&inst)) {
+                if (!isLocal(memset->getDest()))
+                    return false;
+            } else if (auto *call = dyn_cast<CallInst>(&inst)) {
+                if (!pure.count(call->getCalledFunction()))
+                    return false;
+            } else if (inst.mayReadOrWriteMemory()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 先假设签名合适的都是纯函数, 反复剔除不满足条件的, 直到不动点
+static set<const Function*> findPureFunctions(Module &module) {
+    set<const Function*> pure;
+    for (auto &func: module) {
+        if (isUserFunction(func) && hasMemoSignature(func))
+            pure.insert(&func);
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = pure.begin(); it != pure.end();) {
+            if (onlyTouchesLocals(**it, pure)) {
+                it++;
+            } else {
+                it = pure.erase(it);
+                changed = true;
+            }
+        }
+    }
+    return pure;
+}
+
+// 直接或间接调用自己; 不递归的函数查表反而更慢
+static bool isRecursive(const Function* func) {
+    vector<const Function*> work = { func };
+    set<const Function*> seen;
+    while (!work.empty()) {
+        const Function* cur = work.back();
+        work.pop_back();
+        for (auto &block: *cur) {
+            for (auto &inst: block) {
+                auto *call = dyn_cast<CallInst>(&inst);
+                const Function* callee = call ? call->getCalledFunction() : nullptr;
+                if (!callee || callee->isDeclaration())
+                    continue;
+                // musttail 的自调用已经是循环, 查表只会每层多存一项
+                if (callee == func && !(cur == func && call->isMustTailCall()))
+                    return true;
+                if (seen.insert(callee).second)
+                    work.push_back(callee);
+            }
+        }
+    }
+    return false;
+}
+
+// 结果按 64 位存入缓存表
+static Value* toBits(IRBuilder<> &builder, Value* V) {
+    if (V->getType()->isDoubleTy())
+        return builder.CreateBitCast(V, builder.getInt64Ty());
+    return builder.CreateZExt(V, builder.getInt64Ty());
+}
+
+static Value* fromBits(IRBuilder<> &builder, Value* bits, Type* ty) {
+    if (ty->isDoubleTy())
+        return builder.CreateBitCast(bits, ty);
+    return builder.CreateTrunc(bits, ty);
+}
+
+// 所有调用 (包括函数体内非尾调用的递归) 改为调用 <name>.memo:
+// 先查表, 未命中时调用原函数并记录结果
+static void memoize(Function* func) {
+    Module* module = func->getParent();
+    LLVMContext &context = module->getContext();
+    string name = func->getName().str();
+    Function* memo = Function::Create(func->getFunctionType(), Function::InternalLinkage, name + ".memo", module);
+    memo->setCallingConv(CallingConv::Fast);
+    // musttail 的自调用仍调用原函数, 尾递归保持为循环, 不会每层都经过 .memo 而耗尽栈
+    func->replaceUsesWithIf(memo, [func](Use &use) {
+        auto *call = dyn_cast<CallInst>(use.getUser());
+        return !(call && call->isMustTailCall() && call->getFunction() == func);
+    });
+
+    IRBuilder<> builder(BasicBlock::Create(context, "entry", memo));
+    Type* ptrTy = PointerType::getUnqual(context);
+    Type* i32Ty = builder.getInt32Ty();
+    Type* i64Ty = builder.getInt64Ty();
+    auto *table = new GlobalVariable(*module, ptrTy, false, GlobalValue::InternalLinkage,
+                                     ConstantPointerNull::get(cast<PointerType>(ptrTy)), name + ".table");
+    Value* displayName = builder.CreateGlobalStringPtr(name.substr(3), name + ".name");
+
+    unsigned nargs = func->arg_size();
+    Value* args = builder.CreateAlloca(ArrayType::get(i32Ty, nargs), nullptr, "args");
+    vector<Value*> callArgs;
+    for (auto &arg: memo->args()) {
+        builder.CreateStore(&arg, builder.CreateConstGEP2_32(ArrayType::get(i32Ty, nargs), args, 0, arg.getArgNo()));
+        callArgs.push_back(&arg);
+    }
+    Value* value = builder.CreateAlloca(i64Ty, nullptr, "value");
+
+    FunctionCallee lookup = module->getOrInsertFunction("pc_memo_lookup",
+        FunctionType::get(i32Ty, { ptrTy, ptrTy, i32Ty, ptrTy, ptrTy }, false));
+    FunctionCallee store = module->getOrInsertFunction("pc_memo_store",
+        FunctionType::get(builder.getVoidTy(), { ptrTy, ptrTy, i64Ty }, false));
+    Value* hit = builder.CreateCall(lookup, { table, displayName, builder.getInt32(nargs), args, value }, "hit");
+    BasicBlock* hitBB = BasicBlock::Create(context, "hit", memo);
+    BasicBlock* missBB = BasicBlock::Create(context, "miss", memo);
+    builder.CreateCondBr(builder.CreateICmpNE(hit, builder.getInt32(0)), hitBB, missBB);
+
+    builder.SetInsertPoint(hitBB);
+    Value* bits = builder.CreateLoad(i64Ty, value, "bits");
+    builder.CreateRet(fromBits(builder, bits, func->getReturnType()));
+
+    builder.SetInsertPoint(missBB);
+    CallInst* result = builder.CreateCall(func, callArgs, "result");
+    result->setCallingConv(CallingConv::Fast);
+    builder.CreateCall(store, { table, args, toBits(builder, result) });
+    builder.CreateRet(result);
+}
+
+int memoizeFunctions(Module &module) {
+    set<const Function*> pure = findPureFunctions(module);
+    vector<Function*> targets;
+    for (auto &func: module) {
+        if (pure.count(&func) && isRecursive(&func))
+            targets.push_back(&func);
+    }
+    for (Function* func: targets) {
+        memoize(func);
+        *diagnostics << "memoized FUNCTION " << func->getName().substr(3).str() << endl;
+    }
+    return targets.size();
+}
@@ -0,0 +1,13 @@
+#ifndef __MEMOIZE_H__
+#define __MEMOIZE_H__
+
+// --memoize: 递归的纯 FUNCTION 经运行时的缓存表调用, 见 runtime/memo.c
+
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+
+// 在链接运行时之前调用; 返回被缓存的函数个数, 并输出被缓存的函数名
+int memoizeFunctions(Module &module);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __OPTIONS_H__
+#define __OPTIONS_H__
+
+#include <string>
+
+using namespace std;
+
+// 命令行选项, 由 main.cpp 解析, codeGen 时只读
+struct CompilerOptions {
+    // ARRAY OF <record> 按 struct-of-arrays 布局: 每个字段各自连续存放
+    bool soa = false;
+    // -O0 ~ -O3
+    int optLevel = 0;
+    // 链接 runtime/runtime.bc (--no-runtime 则生成的程序链接 libpcrt.a)
+    bool runtime = true;
+    // --memoize: 递归的纯 FUNCTION 按参数缓存结果
+    bool memoize = false;
+    // --profile: 统计每条语句的执行次数, 退出时输出按热度排序的源代码清单
+    bool profile = false;
+    // --run: 用 JIT 直接执行, 不输出文件
+    bool run = false;
+    // --perf: JIT 执行时输出 /tmp/perf-<pid>.map 和 jitdump
+    bool perf = false;
+    // --stats: 在 stderr 上报告各阶段的耗时与内存; --stats-json <file> 另外写成 JSON
+    bool stats = false;
+    string statsJson;
+    // --syntax-only: 只做语法分析; --check: 另做语义检查 (生成 IR 但不初始化目标, 不优化, 不输出).
+    // 都不输出 AST, 只报告错误
+    bool syntaxOnly = false;
+    bool check = false;
+    // --error-limit N: 语法错误达到 N 个后停止解析, 0 为不限制
+    int errorLimit = 20;
+    // 输出 AST 以及代码生成过程; --batch, --syntax-only, --check 时关闭
+    bool dumpAST = true;
+    // --batch <列表文件或目录>: 在一个进程中用多个线程编译多个文件; --jobs N 指定线程数
+    string batch;
+    int jobs = 0;
+    // --tests <列表文件或目录>: 编译一次, 每个 .in 输入 fork 一个子进程执行 (同时 --jobs N 个);
+    // --timeout N: 每个测试最多 N 秒
+    string tests;
+    int timeout = 0;
+    // --trace-out=<file>: Chrome trace (各阶段, 每个 FUNCTION/PROCEDURE 的代码生成, 每个 LLVM pass)
+    string traceOut;
+    // --march=<cpu>: 目标文件针对的 CPU, native 为本机 CPU 及其全部特性; 默认为三元组的通用 CPU.
+    // --run 的代码只在本机执行, 总是针对本机
+    string march;
+    // --cache: 优化后的 bitcode 和目标文件存入磁盘缓存, 命中时跳过语法分析到优化的各阶段
+    bool cache = false;
+    // 源文件路径
+    string input;
+    // -o: .ll, .bc 或目标文件; 为空则把 IR 打印到 stderr
+    string output;
+};
+
+// 每个线程一份: --batch 的工作线程各自复制一份再改 input
+extern thread_local CompilerOptions options;
+
+#endif
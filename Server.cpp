@@ -0,0 +1,265 @@
+#include "Server.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "AST.h"
+#include "Backend.h"
+
+static volatile sig_atomic_t stopping = 0;
+// SIGCHLD 写入这个管道唤醒 poll, 避免在检查子进程和 poll 之间丢失信号
+static int childPipe[2] = { -1, -1 };
+
+static void onStop(int) {
+    stopping = 1;
+}
+
+static void onChild(int) {
+    int saved = errno;
+    char byte = 0;
+    if (write(childPipe[1], &byte, 1) < 0) {
+        // 管道已满时已有未处理的唤醒
+    }
+    errno = saved;
+}
+
+static bool readFully(int fd, void *data, size_t size) {
+    for (char *p = (char *)data; size > 0;) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool receiveRequest(int conn, vector<char> &payload, int fds[3]) {
+    uint32_t size = 0;
+    iovec iov = { &size, sizeof(size) };
+    alignas(cmsghdr) char control[CMSG_SPACE(3 * sizeof(int))];
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0)
+        return false;
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        return false;
+    int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), min(count, 3) * sizeof(int));
+    bool ok = count == 3 && !(msg.msg_flags & MSG_CTRUNC)
+        && ((size_t)n == sizeof(size) || readFully(conn, (char *)&size + n, sizeof(size) - n))
+        && size > 0 && size <= SERVER_MAX_REQUEST;
+    if (ok) {
+        payload.resize(size);
+        ok = readFully(conn, payload.data(), size) && payload.back() == '\0';
+    }
+    if (!ok) {
+        for (int i = 0; i < min(count, 3); i++)
+            close(fds[i]);
+    }
+    return ok;
+}
+
+// conn 为 -1 时客户端已经挂断, 子进程也已被结束
+static void sendStatus(int conn, int status) {
+    if (conn < 0)
+        return;
+    int32_t code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (write(conn, &code, sizeof(code)) != sizeof(code)) {
+        // 客户端已经退出
+    }
+    close(conn);
+}
+
+static void reapChildren(map<pid_t, int> &pending, bool block) {
+    int status;
+    pid_t pid;
+    while (!pending.empty() && (pid = waitpid(-1, &status, block ? 0 : WNOHANG)) > 0) {
+        auto it = pending.find(pid);
+        if (it == pending.end())
+            continue;
+        sendStatus(it->second, status);
+        pending.erase(it);
+    }
+}
+
+// 在子进程中: 换成客户端的标准输入输出, 工作目录和环境变量, 然后按它的参数编译
+[[noreturn]] static void serveRequest(vector<char> &payload, int fds[3]) {
+    for (int i = 0; i < 3; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    vector<const char *> strings;
+    for (size_t i = 0; i < payload.size(); i += strlen(&payload[i]) + 1)
+        strings.push_back(&payload[i]);
+    int argc = strings.size() >= 2 ? atoi(strings[1]) : -1;
+    if (argc < 1 || (size_t)argc + 2 > strings.size()) {
+        fprintf(stderr, "error: malformed request\n");
+        _exit(1);
+    }
+    if (chdir(strings[0]) != 0) {
+        fprintf(stderr, "error: cannot enter %s: %s\n", strings[0], strerror(errno));
+        _exit(1);
+    }
+    clearenv();
+    for (size_t i = argc + 2; i < strings.size(); i++)
+        putenv(const_cast<char *>(strings[i]));
+
+    vector<const char *> argv(strings.begin() + 2, strings.begin() + 2 + argc);
+    argv.push_back(nullptr);
+    // exit 刷新 cout 与 llvm::outs, 并执行程序登记的 atexit (--run --profile 等)
+    exit(runCompiler(argc, argv.data()));
+}
+
+// 默认位置的套接字放在只有本用户能进入的目录中; 目录已经存在时确认它不是别人抢先创建的
+static bool makePrivateDir(const string &dir) {
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+        return false;
+    struct stat status;
+    return lstat(dir.c_str(), &status) == 0 && S_ISDIR(status.st_mode) && status.st_uid == getuid()
+        && (status.st_mode & 077) == 0;
+}
+
+int runServer(const string &socketPath) {
+    // fork 出的子进程直接使用已初始化的目标和 TargetMachine
+    if (!getTargetMachine())
+        return 1;
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        logError("socket path too long");
+        return 1;
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    string privateDir = serverPrivateDir();
+    if (socketPath.compare(0, privateDir.size() + 1, privateDir + "/") == 0 && !makePrivateDir(privateDir)) {
+        logError((privateDir + " is not a private directory of this user").c_str());
+        return 1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || pipe2(childPipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        logError("cannot create socket");
+        return 1;
+    }
+    // 能连上说明已有服务在运行; 连不上的套接字文件是上次异常退出留下的
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool running = probe >= 0 && connect(probe, (sockaddr *)&addr, sizeof(addr)) == 0;
+    close(probe);
+    if (running) {
+        logError(("a server is already listening on " + socketPath).c_str());
+        return 1;
+    }
+    unlink(socketPath.c_str());
+    mode_t mask = umask(077);
+    bool bound = bind(listener, (sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || listen(listener, SOMAXCONN) != 0) {
+        logError(("cannot listen on " + socketPath + ": " + strerror(errno)).c_str());
+        return 1;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = onChild;
+    sigaction(SIGCHLD, &action, nullptr);
+    action.sa_handler = onStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    // 客户端提前退出后写回退出码会触发 SIGPIPE, 不能因此终止整个服务
+    signal(SIGPIPE, SIG_IGN);
+    cout << "listening on " << socketPath << endl;
+
+    // 正在执行的子进程及其客户端连接 (客户端已挂断时为 -1)
+    map<pid_t, int> pending;
+    while (!stopping) {
+        // 客户端的连接也一并等待: 客户端提前退出 (如 Ctrl-C) 时连接挂断, 像直接运行 compiler 时一样中断子进程
+        vector<pollfd> fds = { { listener, POLLIN, 0 }, { childPipe[0], POLLIN, 0 } };
+        vector<pid_t> pids;
+        for (auto &child: pending) {
+            if (child.second < 0)
+                continue;
+            fds.push_back({ child.second, 0, 0 });
+            pids.push_back(child.first);
+        }
+        int ready = poll(fds.data(), fds.size(), -1);
+        if (fds[1].revents & POLLIN) {
+            char buffer[64];
+            while (read(childPipe[0], buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        for (size_t i = 2; ready > 0 && i < fds.size(); i++) {
+            if (fds[i].revents & (POLLHUP | POLLERR)) {
+                kill(pids[i - 2], SIGINT);
+                close(fds[i].fd);
+                pending[pids[i - 2]] = -1;
+            }
+        }
+        reapChildren(pending, false);
+        if (ready <= 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+        int conn = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0)
+            continue;
+        // 请求很小, 客户端卡住时不能拖住整个服务
+        timeval timeout = { 5, 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        vector<char> payload;
+        int clientFds[3];
+        if (!receiveRequest(conn, payload, clientFds)) {
+            close(conn);
+            continue;
+        }
+
+        // 缓冲中的输出不能被子进程再写一遍
+        cout.flush();
+        fflush(nullptr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listener);
+            close(childPipe[0]);
+            close(childPipe[1]);
+            close(conn);
+            for (auto &child: pending) {
+                if (child.second >= 0)
+                    close(child.second);
+            }
+            serveRequest(payload, clientFds);
+        }
+        for (int i = 0; i < 3; i++)
+            close(clientFds[i]);
+        if (pid < 0) {
+            sendStatus(conn, 1 << 8);
+            continue;
+        }
+        pending[pid] = conn;
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    reapChildren(pending, true);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+// --serve: 常驻的编译服务, LLVM 和本机的 TargetMachine 只初始化一次. 请求经 Unix 域套接字到达,
+// 每个请求 fork 一个子进程, 用客户端的 stdin/stdout/stderr, 工作目录, 环境变量和命令行参数
+// 完成一次普通的编译 (或 --run), 服务进程再把子进程的退出码发回客户端. 客户端见 Client.cpp
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// 请求: uint32_t 长度, 然后是若干以 '\0' 结尾的字符串: 工作目录, argc, argv[0] ~ argv[argc - 1], 各个环境变量.
+// 长度字段随 SCM_RIGHTS 附带客户端的 0, 1, 2 三个文件描述符.
+// 回复: int32_t 退出码, 子进程被信号终止时为 128 + 信号
+const uint32_t SERVER_MAX_REQUEST = 1 << 20;
+
+// $XDG_RUNTIME_DIR 未设置时套接字所在的目录, 由服务进程以 0700 创建, 只有本用户能进入
+inline string serverPrivateDir() {
+    return "/tmp/pc-compiler-" + to_string(getuid());
+}
+
+// $PC_SERVER_SOCKET, 默认 $XDG_RUNTIME_DIR/pc-compiler.sock 或 /tmp/pc-compiler-<uid>/server.sock.
+// 客户端连接后还要确认服务进程属于同一用户 (SO_PEERCRED), 否则不发送请求
+inline string serverSocketPath() {
+    if (const char *path = getenv("PC_SERVER_SOCKET"))
+        return path;
+    const char *runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir)
+        return string(runtimeDir) + "/pc-compiler.sock";
+    return serverPrivateDir() + "/server.sock";
+}
+
+// 收到 SIGINT/SIGTERM 前一直运行
+int runServer(const string &socketPath);
+
+// main.cpp 中的一次命令行编译, 子进程按客户端的参数调用
+int runCompiler(int argc, const char *argv[]);
+
+#endif
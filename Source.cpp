@@ -0,0 +1,72 @@
+#include "Source.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+bool SourceFile::load(const string &path) {
+    // 较大的文件直接 mmap, 不复制; 扫描器和行表都只读
+    auto file = MemoryBuffer::getFileOrSTDIN(path, false, false);
+    if (!file || (*file)->getBufferSize() > UINT32_MAX)
+        return false;
+    buffer = std::move(*file);
+    lineStarts.clear();
+    return true;
+}
+
+// 一次扫描整个源文件找出所有换行: 每次比较一个向量宽度的字节, 得到的位掩码中每个 1 是一个换行.
+// 向量部分返回已扫描的字节数, 剩下的尾部由 findLineStarts 处理
+#if defined(__SSE2__)
+static size_t findLineStartsSSE2(const char *data, size_t size, vector<SourceOffset> &lineStarts) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        for (; mask; mask &= mask - 1)
+            lineStarts.push_back(i + __builtin_ctz(mask) + 1);
+    }
+    return i;
+}
+
+// 构建时不加 -mavx2, 只有这个函数按 AVX2 编译, 由 findLineStarts 在运行时确认 CPU 支持后调用
+__attribute__((target("avx2")))
+static size_t findLineStartsAVX2(const char *data, size_t size, vector<SourceOffset> &lineStarts) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        for (; mask; mask &= mask - 1)
+            lineStarts.push_back(i + __builtin_ctz(mask) + 1);
+    }
+    return i;
+}
+#endif
+
+static void findLineStarts(const char *data, size_t size, vector<SourceOffset> &lineStarts) {
+    lineStarts.push_back(0);
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 与 runtime/string_simd.c 一样按运行的 CPU 选择实现; 每个文件只建一次行表
+    if (__builtin_cpu_supports("avx2"))
+        i = findLineStartsAVX2(data, size, lineStarts);
+    else
+        i = findLineStartsSSE2(data, size, lineStarts);
+#endif
+    // 向量宽度之外的尾部, 以及没有 SSE2 的目标 (memchr 本身也是向量化的)
+    for (const char *p; i < size && (p = (const char *)memchr(data + i, '\n', size - i)); i = p - data + 1)
+        lineStarts.push_back(p - data + 1);
+}
+
+LineColumn SourceFile::locate(SourceOffset offset) const {
+    if (lineStarts.empty()) {
+        // 平均每行约 30 个字节, 避免反复扩容
+        lineStarts.reserve(text().size() / 32 + 1);
+        findLineStarts(text().data(), text().size(), lineStarts);
+    }
+    auto next = upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    unsigned line = next - lineStarts.begin();
+    return { line, offset - *(next - 1) + 1 };
+}
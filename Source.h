@@ -0,0 +1,45 @@
+#ifndef __SOURCE_H__
+#define __SOURCE_H__
+
+// 源代码位置: 记号和 AST 节点只记 32 位的字节偏移, 需要行号和列号时 (错误信息, --profile)
+// 再通过行表换算, 行表在第一次换算时才建立
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace std;
+using namespace llvm;
+
+// 源文件中的字节偏移, 源文件不能超过 4 GiB
+typedef uint32_t SourceOffset;
+
+// 记号或 AST 节点覆盖的源代码 [begin, end); 也是语法分析器的 YYLTYPE
+struct SourceRange {
+    SourceOffset begin = 0;
+    SourceOffset end = 0;
+};
+
+// 行号和列号都从 1 开始, 列号按字节计
+struct LineColumn {
+    unsigned line;
+    unsigned column;
+};
+
+// 正在编译的源文件的内容, 由 parseFile 读入, 随 AST 保存到代码生成结束
+class SourceFile {
+    unique_ptr<MemoryBuffer> buffer;
+    // 每行第一个字符的偏移, 第一次 locate 时用 SIMD 扫描整个文件建立
+    mutable vector<SourceOffset> lineStarts;
+
+public:
+    // path 为 "-" 时读 stdin; 失败时返回 false
+    bool load(const string &path);
+    StringRef text() const { return buffer->getBuffer(); }
+    LineColumn locate(SourceOffset offset) const;
+};
+
+#endif
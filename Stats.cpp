@@ -0,0 +1,195 @@
+#include "Stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <ctime>
+#include <sys/resource.h>
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "Options.h"
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "lex", "parse", "semantic", "dump", "irgen", "optimize", "link", "emit", "jit", "execute"
+};
+
+// 计数不区分阶段, 切换阶段时取差值. 每个线程各自计数, --batch 的线程之间不争用同一个计数器;
+// --stats 只用于单个文件, 阶段都在主线程中切换, 读的也是主线程的计数
+static thread_local uint64_t allocCount, allocBytes;
+
+static void *countedAlloc(size_t size, size_t align) {
+    allocCount++;
+    allocBytes += size;
+    if (size == 0)
+        size = 1;
+    for (;;) {
+        void *p = nullptr;
+        if (align <= alignof(max_align_t))
+            p = malloc(size);
+        else if (posix_memalign(&p, align, size) != 0)
+            p = nullptr;
+        if (p)
+            return p;
+        // 编译时没有异常, 没有 new_handler 就直接终止
+        new_handler handler = get_new_handler();
+        if (!handler) {
+            fputs("error: out of memory\n", stderr);
+            abort();
+        }
+        handler();
+    }
+}
+
+// 替换全局的 operator new/delete; 数组和 nothrow 版本在 libstdc++ 中转调这几个
+void *operator new(size_t size) {
+    return countedAlloc(size, 0);
+}
+
+void *operator new(size_t size, align_val_t align) {
+    return countedAlloc(size, (size_t)align);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+struct PhaseStats {
+    bool used = false;
+    double wallMs = 0, cpuMs = 0;
+    uint64_t allocs = 0, allocBytes = 0;
+    // 阶段结束时进程的最大 RSS (ru_maxrss), 不是这个阶段自己的峰值
+    long maxRssKb = 0;
+};
+
+struct Snapshot {
+    double wallMs, cpuMs;
+    uint64_t allocs, allocBytes;
+};
+
+static PhaseStats phases[PHASE_COUNT];
+static Phase current = PHASE_NONE;
+static Snapshot last;
+
+static double clockMs(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static Snapshot snapshot() {
+    return { clockMs(CLOCK_MONOTONIC), clockMs(CLOCK_PROCESS_CPUTIME_ID),
+             allocCount, allocBytes };
+}
+
+// 上次切换以来的开销计入当前阶段, 然后切换到 next
+static Phase switchPhase(Phase next) {
+    Snapshot now = snapshot();
+    if (current != PHASE_NONE) {
+        PhaseStats &stats = phases[current];
+        stats.wallMs += now.wallMs - last.wallMs;
+        stats.cpuMs += now.cpuMs - last.cpuMs;
+        stats.allocs += now.allocs - last.allocs;
+        stats.allocBytes += now.allocBytes - last.allocBytes;
+        // 每个记号都取一次 RSS 代价太大, lex 记为所在 parse 阶段的值
+        if (current != PHASE_LEX) {
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            stats.maxRssKb = max(stats.maxRssKb, usage.ru_maxrss);
+            if (current == PHASE_PARSE)
+                phases[PHASE_LEX].maxRssKb = stats.maxRssKb;
+        }
+    }
+    last = now;
+    Phase outer = current;
+    current = next;
+    if (next != PHASE_NONE)
+        phases[next].used = true;
+    return outer;
+}
+
+// lex 每个记号一次, 太细, 不进 trace (计入 parse)
+PhaseTimer::PhaseTimer(Phase phase)
+    : outer(PHASE_NONE), active(options.stats), traced(phase != PHASE_LEX && llvm::timeTraceProfilerEnabled()) {
+    if (active)
+        outer = switchPhase(phase);
+    if (traced)
+        llvm::timeTraceProfilerBegin(phaseNames[phase], "");
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (traced)
+        llvm::timeTraceProfilerEnd();
+    if (active)
+        switchPhase(outer);
+}
+
+void startTrace() {
+    // 粒度 0: 不丢弃短事件, 小程序的每个 pass 也能看到
+    llvm::timeTraceProfilerInitialize(0, "compiler");
+}
+
+bool finishTrace(const string &path) {
+    llvm::Error err = llvm::timeTraceProfilerWrite(path, options.input);
+    llvm::timeTraceProfilerCleanup();
+    if (err) {
+        llvm::errs() << llvm::toString(std::move(err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool reportStats(const string &jsonPath) {
+    PhaseStats total;
+    fprintf(stderr, "%-10s %10s %10s %10s %12s %14s\n", "phase", "wall ms", "cpu ms", "allocs", "alloc KiB", "max RSS KiB");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats &stats = phases[i];
+        if (!stats.used)
+            continue;
+        fprintf(stderr, "%-10s %10.3f %10.3f %10llu %12.1f %14ld\n", phaseNames[i], stats.wallMs, stats.cpuMs,
+                (unsigned long long)stats.allocs, stats.allocBytes / 1024.0, stats.maxRssKb);
+        total.wallMs += stats.wallMs;
+        total.cpuMs += stats.cpuMs;
+        total.allocs += stats.allocs;
+        total.allocBytes += stats.allocBytes;
+        total.maxRssKb = max(total.maxRssKb, stats.maxRssKb);
+    }
+    fprintf(stderr, "%-10s %10.3f %10.3f %10llu %12.1f %14ld\n", "total", total.wallMs, total.cpuMs,
+            (unsigned long long)total.allocs, total.allocBytes / 1024.0, total.maxRssKb);
+
+    if (jsonPath.empty())
+        return true;
+    FILE *file = fopen(jsonPath.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "error: cannot write %s\n", jsonPath.c_str());
+        return false;
+    }
+    fprintf(file, "{\n  \"phases\": [\n");
+    bool first = true;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats &stats = phases[i];
+        if (!stats.used)
+            continue;
+        fprintf(file, "%s    {\"name\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %llu, "
+                "\"alloc_bytes\": %llu, \"max_rss_kb\": %ld}", first ? "" : ",\n", phaseNames[i], stats.wallMs,
+                stats.cpuMs, (unsigned long long)stats.allocs, (unsigned long long)stats.allocBytes, stats.maxRssKb);
+        first = false;
+    }
+    fprintf(file, "\n  ],\n  \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %llu, "
+            "\"alloc_bytes\": %llu, \"max_rss_kb\": %ld}\n}\n", total.wallMs, total.cpuMs,
+            (unsigned long long)total.allocs, (unsigned long long)total.allocBytes, total.maxRssKb);
+    fclose(file);
+    return true;
+}
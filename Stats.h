@@ -0,0 +1,46 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+// --stats: 各编译阶段的墙钟时间, CPU 时间, operator new 的次数与字节数, 阶段结束时进程的最大 RSS
+// --trace-out: 各阶段同时作为 LLVM time-trace 的事件输出
+
+#include <string>
+
+using namespace std;
+
+// 阶段可以嵌套 (lex 发生在 parse 之中), 开销只计入最内层的阶段
+enum Phase {
+    PHASE_NONE = -1,
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_SEMANTIC,
+    PHASE_DUMP,
+    PHASE_IRGEN,
+    PHASE_OPTIMIZE,
+    PHASE_LINK,
+    PHASE_EMIT,
+    PHASE_JIT,
+    PHASE_EXECUTE,
+    PHASE_COUNT
+};
+
+// 作用域内的开销计入 phase, 结束时回到外层阶段; 没有 --stats 和 --trace-out 时什么也不做
+class PhaseTimer {
+    Phase outer;
+    bool active;
+    bool traced;
+
+public:
+    explicit PhaseTimer(Phase phase);
+    ~PhaseTimer();
+};
+
+// 文本输出到 stderr; jsonPath 非空时另外写 JSON
+bool reportStats(const string &jsonPath);
+
+// --trace-out: 开始记录 Chrome trace 事件; LLVM 的每个 pass 由 pass manager 自己记录
+void startTrace();
+// 写出 trace 文件并停止记录
+bool finishTrace(const string &path);
+
+#endif
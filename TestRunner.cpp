@@ -0,0 +1,156 @@
+#include "TestRunner.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "AST.h"
+#include "Batch.h"
+#include "Options.h"
+
+struct Test {
+    string input;
+    string output;
+    chrono::steady_clock::time_point start;
+};
+
+static string outputPath(const string &input) {
+    SmallString<256> path(options.output.empty() ? sys::path::parent_path(input) : StringRef(options.output));
+    sys::path::append(path, sys::path::stem(input) + ".out");
+    return path.str().str();
+}
+
+// 去掉每行末尾的空白和 '\r', 以及末尾的空行
+static string normalizeOutput(StringRef text) {
+    string result;
+    while (!text.empty()) {
+        pair<StringRef, StringRef> line = text.split('\n');
+        result += line.first.rtrim(" \t\r").str();
+        result += '\n';
+        text = line.second;
+    }
+    while (result.size() >= 2 && result[result.size() - 1] == '\n' && result[result.size() - 2] == '\n')
+        result.pop_back();
+    return result == "\n" ? "" : result;
+}
+
+// 在子进程中: stdin 换成测试输入, stdout 换成输出文件, 然后执行已经生成好的 main
+[[noreturn]] static void runChild(MainFunction mainFunction, const Test &test) {
+    int in = open(test.input.c_str(), O_RDONLY | O_CLOEXEC);
+    int out = open(test.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (in < 0 || out < 0) {
+        fprintf(stderr, "error: %s: %s\n", in < 0 ? test.input.c_str() : test.output.c_str(), strerror(errno));
+        _exit(127);
+    }
+    dup2(in, 0);
+    dup2(out, 1);
+    signal(SIGINT, SIG_DFL);
+    if (options.timeout > 0)
+        alarm(options.timeout);
+    // exit 刷新程序的输出, 并执行程序登记的 atexit
+    exit(mainFunction());
+}
+
+// 返回测试是否通过
+static bool report(const Test &test, int status) {
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - test.start).count();
+    string result;
+    bool ok = false;
+    if (WIFSIGNALED(status)) {
+        result = WTERMSIG(status) == SIGALRM ? "timeout" : string("signal ") + strsignal(WTERMSIG(status));
+    } else if (WEXITSTATUS(status) != 0) {
+        result = "exit " + to_string(WEXITSTATUS(status));
+    } else {
+        SmallString<256> expectedPath(test.input);
+        sys::path::replace_extension(expectedPath, ".expected");
+        auto expected = MemoryBuffer::getFile(expectedPath);
+        if (!expected) {
+            // 没有期望的输出, 只要正常退出
+            ok = true;
+        } else {
+            auto actual = MemoryBuffer::getFile(test.output);
+            ok = actual && normalizeOutput((*actual)->getBuffer()) == normalizeOutput((*expected)->getBuffer());
+            if (!ok)
+                result = "wrong output";
+        }
+    }
+
+    char time[32];
+    snprintf(time, sizeof(time), "%9.1f ms  ", ms);
+    cout << (ok ? "pass    " : "FAILED  ") << time << test.input;
+    if (!result.empty())
+        cout << " (" << result << ")";
+    cout << "\n";
+    return ok;
+}
+
+int runTests(MainFunction mainFunction, const string &source) {
+    vector<string> inputs;
+    if (!collectInputs(source, ".in", inputs)) {
+        logError("cannot read test list");
+        return 1;
+    }
+    if (!options.output.empty()) {
+        if (error_code ec = sys::fs::create_directories(options.output)) {
+            logError(("cannot create " + options.output + ": " + ec.message()).c_str());
+            return 1;
+        }
+    }
+
+    vector<Test> tests;
+    for (const string &input: inputs)
+        tests.push_back({ input, outputPath(input), {} });
+    size_t jobs = options.jobs > 0 ? options.jobs : 1;
+
+    // 正在执行的子进程及其测试
+    map<pid_t, size_t> running;
+    size_t next = 0;
+    int failed = 0;
+    while (next < tests.size() || !running.empty()) {
+        while (next < tests.size() && running.size() < jobs) {
+            Test &test = tests[next];
+            // 缓冲中的输出 (包括之前的结果行) 不能被子进程再写一遍
+            cout.flush();
+            fflush(nullptr);
+            test.start = chrono::steady_clock::now();
+            pid_t pid = fork();
+            if (pid == 0)
+                runChild(mainFunction, test);
+            if (pid < 0) {
+                report(test, 127 << 8);
+                failed++;
+            } else {
+                running[pid] = next;
+            }
+            next++;
+        }
+        if (running.empty())
+            continue;
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        auto it = running.find(pid);
+        if (it == running.end())
+            continue;
+        if (!report(tests[it->second], status))
+            failed++;
+        running.erase(it);
+    }
+
+    cout << tests.size() - failed << "/" << tests.size() << " passed" << endl;
+    return failed;
+}
@@ -0,0 +1,17 @@
+#ifndef __TEST_RUNNER_H__
+#define __TEST_RUNNER_H__
+
+// --tests: 程序只编译一次 (JIT), 然后每个测试输入 fork 一个子进程执行 main,
+// 每个测试的开销是一次 fork, 而不是一次编译或启动进程
+
+#include <string>
+#include "JIT.h"
+
+using namespace std;
+
+// source 是列表文件或目录 (其中所有 .in 文件), 每个 .in 是一个测试的 stdin.
+// stdout 写入同名的 .out (-o 给出输出目录, 默认与 .in 同目录); 有同名的 .expected 时与之比较,
+// 忽略行尾空白和末尾的空行. 每个测试一行结果输出到 stdout, 返回失败的测试数
+int runTests(MainFunction mainFunction, const string &source);
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/sh
+# 比较两次 run_programs.sh 的结果: 每行的墙钟时间与分配字节数之比, 超过 THRESHOLD (默认 1.10) 的标出
+#
+#   bench/compare.sh old.tsv new.tsv
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 old.tsv new.tsv" >&2
+    exit 2
+fi
+
+awk -F '\t' -v threshold="${THRESHOLD:-1.10}" '
+    function ratio(a, b) { return (a == "-" || b == "-" || a + 0 == 0) ? "-" : sprintf("%.2f", b / a) }
+    FNR == 1 { next }
+    NR == FNR { wall[$1, $2, $3, $4] = $5; bytes[$1, $2, $3, $4] = $8; next }
+    {
+        key = $1 SUBSEP $2 SUBSEP $3 SUBSEP $4
+        if (!(key in wall)) {
+            printf "%-12s %-4s %-3s %-10s %10s\n", $1, $2, $3, $4, "new"
+            next
+        }
+        w = ratio(wall[key], $5)
+        b = ratio(bytes[key], $8)
+        mark = (w != "-" && w + 0 > threshold) || (b != "-" && b + 0 > threshold) ? "  <-- regression" : ""
+        printf "%-12s %-4s %-3s %-10s %10s %10s ms  x%-5s alloc x%s%s\n", $1, $2, $3, $4, wall[key], $5, w, b, mark
+    }' "$1" "$2"
@@ -0,0 +1,160 @@
+// 生成指定规模与形状的合法伪代码程序, 用于测量词法, 语法分析和代码生成随输入规模的变化
+//
+//   gen_program [-s shape] [-n lines] [-d depth] [-w width] > program.pc
+//
+// shape:
+//   procedures   大量短小的 PROCEDURE, 主程序逐个调用
+//   nesting      嵌套 depth 层的 IF/FOR 块
+//   expressions  每行一条 width 项的长表达式
+//   block        一个巨大的顶层块, 全是简单赋值
+//   mixed        以上几种轮流出现
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLOBALS 16
+
+static long lines, target = 10000;
+static int depth = 20, width = 50;
+static unsigned seed = 1;
+
+static unsigned nextRandom(void) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void line(int indent, const char *fmt, ...) {
+    va_list args;
+    printf("%*s", indent * 4, "");
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+    lines++;
+}
+
+static void simpleAssign(int indent) {
+    line(indent, "G%u <- G%u + %u", nextRandom() % GLOBALS, nextRandom() % GLOBALS, nextRandom() % 100);
+}
+
+// 每个 PROCEDURE 约 10 行; 返回生成的个数
+static long genProcedures(long budget, long first) {
+    long count = 0;
+    for (long start = lines; lines - start + 10 <= budget || count == 0; count++) {
+        line(0, "PROCEDURE P%ld(A : INTEGER, BYREF B : INTEGER)", first + count);
+        line(1, "DECLARE L : INTEGER");
+        line(1, "L <- A * %u + G%u", nextRandom() % 10 + 1, nextRandom() % GLOBALS);
+        line(1, "IF L > %u THEN", nextRandom() % 1000);
+        line(2, "B <- L MOD %u", nextRandom() % 97 + 1);
+        line(1, "ELSE");
+        line(2, "B <- B + L");
+        line(1, "ENDIF");
+        simpleAssign(1);
+        line(0, "ENDPROCEDURE");
+    }
+    return count;
+}
+
+static void genNesting(long budget) {
+    for (long start = lines; lines - start + 2 * depth + 1 <= budget || lines == start;) {
+        for (int d = 0; d < depth; d++) {
+            if (d % 2 == 0)
+                line(d, "IF G%u > %u THEN", nextRandom() % GLOBALS, nextRandom() % 100);
+            else
+                line(d, "FOR I%d <- 1 TO %u", d, nextRandom() % 3 + 1);
+        }
+        simpleAssign(depth);
+        for (int d = depth - 1; d >= 0; d--)
+            line(d, d % 2 == 0 ? "ENDIF" : "NEXT");
+    }
+}
+
+static void genExpressions(long budget) {
+    static const char *ops[] = { " + ", " - ", " * " };
+    for (long start = lines; lines - start < budget;) {
+        printf("G%u <- ", nextRandom() % GLOBALS);
+        for (int i = 0; i < width; i++) {
+            if (i > 0)
+                fputs(ops[nextRandom() % 3], stdout);
+            // 偶尔加括号, 避免只有一条左深链
+            if (i + 1 < width && nextRandom() % 8 == 0) {
+                printf("(G%u + %u)", nextRandom() % GLOBALS, nextRandom() % 100);
+                continue;
+            }
+            if (nextRandom() % 2)
+                printf("G%u", nextRandom() % GLOBALS);
+            else
+                printf("%u", nextRandom() % 100);
+        }
+        putchar('\n');
+        lines++;
+    }
+}
+
+static void genBlock(long budget) {
+    for (long start = lines; lines - start < budget;)
+        simpleAssign(0);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-s procedures|nesting|expressions|block|mixed] [-n lines] [-d depth] [-w width]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    const char *shape = "mixed";
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc)
+            usage(argv[0]);
+        if (strcmp(argv[i], "-s") == 0)
+            shape = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0)
+            target = atol(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0)
+            depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0)
+            width = atoi(argv[++i]);
+        else
+            usage(argv[0]);
+    }
+    if (target <= 0 || depth <= 0 || width <= 0)
+        usage(argv[0]);
+
+    line(0, "// generated by bench/gen_program -s %s -n %ld", shape, target);
+    for (int g = 0; g < GLOBALS; g++)
+        line(0, "DECLARE G%d : INTEGER", g);
+    for (int d = 1; d < depth; d += 2)
+        line(0, "DECLARE I%d : INTEGER", d);
+    line(0, "DECLARE R : INTEGER");
+
+    long procedures = 0;
+    if (strcmp(shape, "procedures") == 0) {
+        // 调用各占一行
+        procedures = genProcedures((target - lines) * 10 / 11, 0);
+    } else if (strcmp(shape, "nesting") == 0) {
+        genNesting(target - lines);
+    } else if (strcmp(shape, "expressions") == 0) {
+        genExpressions(target - lines);
+    } else if (strcmp(shape, "block") == 0) {
+        genBlock(target - lines);
+    } else if (strcmp(shape, "mixed") == 0) {
+        // 每轮 4 段, 每段约 1000 行
+        while (lines < target) {
+            long chunk = target - lines < 4000 ? (target - lines) / 4 + 1 : 1000;
+            procedures += genProcedures(chunk, procedures);
+            genNesting(chunk);
+            genExpressions(chunk);
+            genBlock(chunk);
+        }
+    } else {
+        usage(argv[0]);
+    }
+    for (long p = 0; p < procedures; p++)
+        line(0, "CALL P%ld(%u, R)", p, nextRandom() % 100);
+    line(0, "OUTPUT G0");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#!/bin/sh
+# 基准程序集: 对 bench/programs/*.pc 的每个程序, 每种后端 (jit: --run; aot: 目标文件 + 链接 + 执行)
+# 和每个 -O 级别, 记录各阶段的耗时与内存. 每项取 REPEAT 次中的最小值.
+#
+#   make bench-programs > new.tsv
+#   bench/compare.sh old.tsv new.tsv
+#
+# 输出为制表符分隔, 行序固定, 不可用的量记为 "-":
+#   program backend opt phase wall_ms cpu_ms allocs alloc_bytes max_rss_kb
+#
+# 环境变量: COMPILER (默认 ./compiler), CC (默认 clang, 链接阶段记为 ld), REPEAT (默认 3),
+#           LEVELS (默认 "0 1 2 3"), BACKENDS (默认 "jit aot"), PROGRAMS (默认 bench/programs/*.pc)
+
+COMPILER=${COMPILER:-./compiler}
+CC=${CC:-clang}
+REPEAT=${REPEAT:-3}
+LEVELS=${LEVELS:-"0 1 2 3"}
+BACKENDS=${BACKENDS:-"jit aot"}
+PROGRAMS=${PROGRAMS:-$(ls bench/programs/*.pc)}
+RUNTIME_LIB=${RUNTIME_LIB:-runtime/libpcrt.a}
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now_ns() {
+    date +%s%N
+}
+
+# --stats-json 的每个阶段一行, 转成 "phase wall cpu allocs bytes rss"
+stats_rows() {
+    sed -n 's/.*"name": "\([a-z]*\)", "wall_ms": \([0-9.]*\), "cpu_ms": \([0-9.]*\), "allocs": \([0-9]*\), "alloc_bytes": \([0-9]*\), "max_rss_kb": \([0-9]*\)}.*/\1 \2 \3 \4 \5 \6/p' "$1"
+}
+
+# 同一配置的多次运行按阶段取最小值, 阶段保持第一次出现的顺序
+min_rows() {
+    awk -v prefix="$1" '
+        function less(a, b) { return b == "" || (a != "-" && a + 0 < b + 0) }
+        {
+            if (!($1 in seen)) { seen[$1] = 1; order[n++] = $1 }
+            for (i = 2; i <= 6; i++)
+                if (less($i, best[$1, i])) best[$1, i] = $i
+        }
+        END {
+            for (k = 0; k < n; k++) {
+                p = order[k]
+                printf "%s\t%s", prefix, p
+                for (i = 2; i <= 6; i++) printf "\t%s", best[p, i]
+                printf "\n"
+            }
+        }'
+}
+
+printf 'program\tbackend\topt\tphase\twall_ms\tcpu_ms\tallocs\talloc_bytes\tmax_rss_kb\n'
+for program in $PROGRAMS; do
+    name=$(basename "$program" .pc)
+    for backend in $BACKENDS; do
+        for level in $LEVELS; do
+            : > "$TMP/rows"
+            run=0
+            while [ $run -lt "$REPEAT" ]; do
+                run=$((run + 1))
+                if [ "$backend" = jit ]; then
+                    if ! "$COMPILER" --run -O"$level" --stats-json "$TMP/stats.json" "$program" \
+                            > /dev/null 2> "$TMP/err" < /dev/null; then
+                        echo "error: $name jit -O$level failed" >&2
+                        cat "$TMP/err" >&2
+                        continue
+                    fi
+                    stats_rows "$TMP/stats.json" >> "$TMP/rows"
+                else
+                    if ! "$COMPILER" -O"$level" -o "$TMP/$name.o" --stats-json "$TMP/stats.json" "$program" \
+                            > /dev/null 2> "$TMP/err"; then
+                        echo "error: $name aot -O$level failed" >&2
+                        cat "$TMP/err" >&2
+                        continue
+                    fi
+                    stats_rows "$TMP/stats.json" >> "$TMP/rows"
+                    start=$(now_ns)
+                    "$CC" -o "$TMP/$name" "$TMP/$name.o" "$RUNTIME_LIB" -lm
+                    middle=$(now_ns)
+                    "$TMP/$name" > /dev/null < /dev/null
+                    end=$(now_ns)
+                    # 链接器和生成的程序是子进程, 只记墙钟时间
+                    echo "ld $(( (middle - start) / 1000 )) - - - -" | awk '{ $2 = $2 / 1000; print }' >> "$TMP/rows"
+                    echo "execute $(( (end - middle) / 1000 )) - - - -" | awk '{ $2 = $2 / 1000; print }' >> "$TMP/rows"
+                fi
+            done
+            min_rows "$name	$backend	O$level" < "$TMP/rows"
+        done
+    done
+done
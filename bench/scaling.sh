@@ -0,0 +1,69 @@
+#!/bin/sh
+# 规模测试: 用 bench/gen_program 生成各种形状, 各种行数的程序, 记录编译器每个阶段的时间和内存.
+#
+#   make bench-scaling > scaling.tsv
+#
+# stdout 为制表符分隔的结果:
+#   shape lines phase wall_ms cpu_ms allocs alloc_bytes max_rss_kb us_per_line
+# stderr 为每种形状, 每个阶段的图: 每行一个规模, 横条长度为每行源代码的耗时.
+# 横条长度不随规模增长说明该阶段是线性的.
+#
+# 默认只生成 bitcode (-o .bc), 不做优化和机器码生成, 测的是词法, 语法分析和 IR 生成;
+# EMIT=o 时改为生成目标文件.
+#
+# 环境变量: COMPILER (默认 ./compiler), GEN (默认 bench/gen_program),
+#           SIZES (默认 "10000 100000 1000000"), SHAPES (默认 "procedures nesting expressions block"),
+#           EMIT (默认 bc), OPT (默认 0)
+
+COMPILER=${COMPILER:-./compiler}
+GEN=${GEN:-bench/gen_program}
+SIZES=${SIZES:-"10000 100000 1000000"}
+SHAPES=${SHAPES:-"procedures nesting expressions block"}
+EMIT=${EMIT:-bc}
+OPT=${OPT:-0}
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+printf 'shape\tlines\tphase\twall_ms\tcpu_ms\tallocs\talloc_bytes\tmax_rss_kb\tus_per_line\n' | tee "$TMP/all.tsv"
+for shape in $SHAPES; do
+    for size in $SIZES; do
+        "$GEN" -s "$shape" -n "$size" > "$TMP/input.pc"
+        lines=$(wc -l < "$TMP/input.pc")
+        if ! "$COMPILER" -O"$OPT" -o "$TMP/output.$EMIT" --stats-json "$TMP/stats.json" "$TMP/input.pc" \
+                > /dev/null 2> "$TMP/err"; then
+            echo "error: $shape $size failed" >&2
+            tail -n 5 "$TMP/err" >&2
+            continue
+        fi
+        sed -n 's/.*"name": "\([a-z]*\)", "wall_ms": \([0-9.]*\), "cpu_ms": \([0-9.]*\), "allocs": \([0-9]*\), "alloc_bytes": \([0-9]*\), "max_rss_kb": \([0-9]*\)}.*/\1 \2 \3 \4 \5 \6/p' \
+                "$TMP/stats.json" |
+            awk -v shape="$shape" -v lines="$lines" '{
+                printf "%s\t%d\t%s\t%s\t%s\t%s\t%s\t%s\t%.3f\n", shape, lines, $1, $2, $3, $4, $5, $6, $2 * 1000 / lines
+            }' | tee -a "$TMP/all.tsv"
+    done
+done
+
+# 图: 同一形状的所有阶段共用一个比例尺
+awk -F '\t' '
+    NR == 1 { next }
+    {
+        key = $1 SUBSEP $3
+        if (!(key in seen)) { seen[key] = 1; order[n++] = key }
+        rows[key] = rows[key] sprintf("%d\t%s\t%s\t%s\n", $2, $9, $4, $8)
+        if ($9 + 0 > scale[$1]) scale[$1] = $9 + 0
+    }
+    END {
+        for (k = 0; k < n; k++) {
+            split(order[k], part, SUBSEP)
+            printf "\n%s / %s (us per line, total ms, max RSS KiB)\n", part[1], part[2]
+            m = split(rows[order[k]], lines, "\n")
+            for (i = 1; i < m; i++) {
+                split(lines[i], f, "\t")
+                width = scale[part[1]] > 0 ? int(f[2] / scale[part[1]] * 50 + 0.5) : 0
+                bar = ""
+                for (j = 0; j < width; j++) bar = bar "#"
+                printf "%9d |%-50s %9.3f %12.1f %10d\n", f[1], bar, f[2], f[3], f[4]
+            }
+        }
+    }' "$TMP/all.tsv" >&2
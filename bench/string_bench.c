@@ -0,0 +1,80 @@
+// 字符串内置函数的微基准: 每种长度下比较标量, SSE2, AVX2 实现的吞吐
+// make bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../runtime/runtime.h"
+
+static const char *levelNames[] = { "scalar", "sse2", "avx2" };
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 每组至少跑 50ms, 返回每字节纳秒数
+static double measure(int which, const pc_string *s, size_t length) {
+    size_t iterations = 0;
+    int64_t sink = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 64; i++) {
+            pc_string out;
+            switch (which) {
+            case 0:
+                pc_ucase(&out, s);
+                sink += out.bytes[0];
+                break;
+            case 1:
+                sink += pc_find_char(s, '#');
+                break;
+            case 2:
+                pc_lcase(&out, s);
+                sink += out.bytes[0];
+                break;
+            }
+        }
+        iterations += 64;
+        elapsed = now() - start;
+    } while (elapsed < 0.05);
+    if (sink == 42)
+        printf(" ");
+    return elapsed * 1e9 / ((double)iterations * length);
+}
+
+int main(void) {
+    static const size_t lengths[] = { 8, 64, 1024, 65536 };
+    static const char *names[] = { "UCASE", "FIND char", "LCASE" };
+
+    printf("%-10s %8s", "builtin", "length");
+    for (int level = PC_SIMD_SCALAR; level <= PC_SIMD_AVX2; level++)
+        printf(" %12s", levelNames[level]);
+    printf("   (ns/byte)\n");
+
+    for (int which = 0; which < 3; which++) {
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t length = lengths[l];
+            char *data = malloc(length);
+            srand(42);
+            for (size_t i = 0; i < length; i++)
+                data[i] = 'A' + rand() % 58;
+            pc_string s;
+            pc_string_copy(&s, data, length);
+
+            printf("%-10s %8zu", names[which], length);
+            for (int level = PC_SIMD_SCALAR; level <= PC_SIMD_AVX2; level++) {
+                if (pc_simd_select(level) != level) {
+                    printf(" %12s", "-");
+                    continue;
+                }
+                printf(" %12.3f", measure(which, &s, length));
+            }
+            printf("\n");
+            free(data);
+        }
+    }
+    return 0;
+}
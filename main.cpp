@@ -6,28 +6,184 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
 #include "AST.h"
+#include "Backend.h"
+#include "Batch.h"
+#include "Cache.h"
+#include "Compile.h"
+#include "JIT.h"
+#include "Options.h"
+#include "Server.h"
+#include "Stats.h"
+#include "TestRunner.h"
 
 using namespace std;
 
-extern FILE *yyin;
-extern int yyparse(unique_ptr<BaseAST> &ast);
+thread_local CompilerOptions options;
+
+int runCompiler(int argc, const char *argv[]) {
+    options = CompilerOptions();
+    const char *input = nullptr;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--soa")
+            options.soa = true;
+        else if (arg == "--memoize")
+            options.memoize = true;
+        else if (arg == "--profile")
+            options.profile = true;
+        else if (arg == "--run")
+            options.run = true;
+        else if (arg == "--perf")
+            options.perf = true;
+        else if (arg == "--syntax-only")
+            options.syntaxOnly = true;
+        else if (arg == "--check")
+            options.check = true;
+        else if (arg == "--error-limit" && i + 1 < argc)
+            options.errorLimit = atoi(argv[++i]);
+        else if (arg == "--stats")
+            options.stats = true;
+        else if (arg == "--stats-json" && i + 1 < argc) {
+            options.stats = true;
+            options.statsJson = argv[++i];
+        } else if (arg.compare(0, 12, "--trace-out=") == 0)
+            options.traceOut = arg.substr(12);
+        else if (arg.compare(0, 8, "--march=") == 0)
+            options.march = arg.substr(8);
+        else if (arg == "--cache")
+            options.cache = true;
+        else if (arg == "--cache-stats") {
+            printCacheStats();
+            return 0;
+        } else if (arg == "--no-runtime")
+            options.runtime = false;
+        else if (arg == "--batch" && i + 1 < argc)
+            options.batch = argv[++i];
+        else if (arg == "--tests" && i + 1 < argc) {
+            options.tests = argv[++i];
+            options.run = true;
+        } else if (arg == "--timeout" && i + 1 < argc)
+            options.timeout = atoi(argv[++i]);
+        else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc)
+            options.jobs = atoi(argv[++i]);
+        else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && isdigit(arg[2]))
+            options.optLevel = arg[2] - '0';
+        else if (arg == "-o" && i + 1 < argc)
+            options.output = argv[++i];
+        else
+            input = argv[i];
+    }
+    if (!options.batch.empty()) {
+        if (options.run || options.stats || !options.traceOut.empty()) {
+            logError("--batch cannot be combined with --run, --stats or --trace-out");
+            return 1;
+        }
+        return runBatch(options.batch) ? 1 : 0;
+    }
+    assert(input);
+    options.input = input;
+
+    if (!options.traceOut.empty())
+        startTrace();
+
+    // 不生成代码的模式: 只报告错误, 退出码表示有没有错误
+    if (options.syntaxOnly || options.check) {
+        options.dumpAST = false;
+        int exitCode = checkFile(input, options.check) ? 0 : 1;
+        if (options.stats && !reportStats(options.statsJson))
+            return 1;
+        if (!options.traceOut.empty() && !finishTrace(options.traceOut))
+            return 1;
+        return exitCode;
+    }
+
+    // 目标文件整个缓存; --run, .ll, .bc 和打印 IR 共用优化后的 bitcode
+    StringRef output(options.output);
+    bool object = !options.run && !output.empty() && !output.endswith(".ll") && !output.endswith(".bc");
+    string key = options.cache ? cacheKey(input, object ? "o" : "bc") : "";
+    bool cachedObject = false;
+    unique_ptr<LLVMContext> cachedContext;
+    unique_ptr<Module> cachedModule;
+    if (!key.empty()) {
+        if (object) {
+            PhaseTimer timer(PHASE_EMIT);
+            cachedObject = cacheFetchFile(key, options.output);
+        } else if (unique_ptr<MemoryBuffer> bitcode = cacheLookup(key)) {
+            cachedContext = make_unique<LLVMContext>();
+            Expected<unique_ptr<Module>> parsed = parseBitcodeFile(bitcode->getMemBufferRef(), *cachedContext);
+            if (parsed) {
+                cachedModule = std::move(*parsed);
+                // 标识符会变成缓存文件的路径; 改回原来的, JIT 的目标文件缓存才能命中
+                cachedModule->setModuleIdentifier(cachedModule->getSourceFileName());
+            } else {
+                consumeError(parsed.takeError());
+            }
+        }
+    }
+
+    int exitCode = 0;
+    if (!cachedObject) {
+        // 命中时没有 AST, 也就没有 AST 的输出
+        Module* module = cachedModule.get();
+        if (!module) {
+            unique_ptr<BaseAST> ast = parseFile(input);
+            if (!ast)
+                return 1;
+
+            // dump AST
+            {
+                PhaseTimer timer(PHASE_DUMP);
+                ast->dump("", 0);
+            }
+            if (!generateModule(*ast))
+                return 1;
+            module = getModule();
+            if (!key.empty() && !object) {
+                SmallVector<char, 0> bitcode;
+                raw_svector_ostream out(bitcode);
+                // 保留 use-list 的顺序, 读回的 module 打印出的 IR 与原来的相同 (JIT 的缓存以此为键)
+                WriteBitcodeToFile(*module, out, true);
+                cacheStore(key, StringRef(bitcode.data(), bitcode.size()));
+            }
+        }
+        if (options.run) {
+            // AST 的输出要先于程序的输出
+            cout.flush();
+            auto owned = cachedModule ? make_pair(std::move(cachedContext), std::move(cachedModule)) : takeModule();
+            if (!options.tests.empty()) {
+                MainFunction mainFunction = compileJIT(std::move(owned.first), std::move(owned.second));
+                if (!mainFunction)
+                    return 1;
+                PhaseTimer timer(PHASE_EXECUTE);
+                exitCode = runTests(mainFunction, options.tests) ? 1 : 0;
+            } else if (!runJIT(std::move(owned.first), std::move(owned.second), exitCode))
+                return 1;
+        } else if (!options.output.empty()) {
+            PhaseTimer timer(PHASE_EMIT);
+            if (!emitFile(*module, options.output))
+                return 1;
+            if (object && !key.empty())
+                cacheStoreFile(key, options.output);
+        } else {
+            PhaseTimer timer(PHASE_EMIT);
+            module->print(llvm::errs(), nullptr);
+            cout << endl;
+        }
+    }
+
+    if (options.stats && !reportStats(options.statsJson))
+        return 1;
+    if (!options.traceOut.empty() && !finishTrace(options.traceOut))
+        return 1;
+    return exitCode;
+}
 
 int main(int argc, const char *argv[]) {
-    assert(argc == 2);
-    auto input = argv[1];
-
-    yyin = fopen(input, "r");
-    assert(yyin);
-
-    unique_ptr<BaseAST> ast;
-    auto ret = yyparse(ast);
-    assert(!ret);
-
-    // dump AST
-    ast->dump("", 0);
-    ast->codeGen()->print(llvm::errs());
-    cout << endl;
-    
-    return 0;
+    if (argc == 2 && string(argv[1]) == "--serve")
+        return runServer(serverSocketPath());
+    return runCompiler(argc, argv);
 }
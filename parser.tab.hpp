@@ -1,131 +0,0 @@
-/* A Bison parser, made by GNU Bison 3.8.2.  */
-
-/* Bison interface for Yacc-like parsers in C
-
-   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
-   Inc.
-
-   This program is free software: you can redistribute it and/or modify
-   it under the terms of the GNU General Public License as published by
-   the Free Software Foundation, either version 3 of the License, or
-   (at your option) any later version.
-
-   This program is distributed in the hope that it will be useful,
-   but WITHOUT ANY WARRANTY; without even the implied warranty of
-   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-   GNU General Public License for more details.
-
-   You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
-
-/* As a special exception, you may create a larger work that contains
-   part or all of the Bison parser skeleton and distribute that work
-   under terms of your choice, so long as that work isn't itself a
-   parser generator using the skeleton or a modified version thereof
-   as a parser skeleton.  Alternatively, if you modify or redistribute
-   the parser skeleton itself, you may (at your option) remove this
-   special exception, which will cause the skeleton and the resulting
-   Bison output files to be licensed under the GNU General Public
-   License without this special exception.
-
-   This special exception was added by the Free Software Foundation in
-   version 2.2 of Bison.  */
-
-/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
-   especially those whose name start with YY_ or yy_.  They are
-   private implementation details that can be changed or removed.  */
-
-#ifndef YY_YY_PARSER_TAB_HPP_INCLUDED
-# define YY_YY_PARSER_TAB_HPP_INCLUDED
-/* Debug traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
-#if YYDEBUG
-extern int yydebug;
-#endif
-/* "%code requires" blocks.  */
-#line 3 "parser.y"
-
-    #include <iostream>
-    #include <memory>
-    #include <string>
-    #include <vector>
-    #include "AST.h"
-
-#line 57 "parser.tab.hpp"
-
-/* Token kinds.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-  enum yytokentype
-  {
-    YYEMPTY = -2,
-    YYEOF = 0,                     /* "end of file"  */
-    YYerror = 256,                 /* error  */
-    YYUNDEF = 257,                 /* "invalid token"  */
-    OUTPUT = 258,                  /* OUTPUT  */
-    IDENT = 259,                   /* IDENT  */
-    FUNCTION = 260,                /* FUNCTION  */
-    ENDFUNCTION = 261,             /* ENDFUNCTION  */
-    PROCEDURE = 262,               /* PROCEDURE  */
-    ENDPROCEDURE = 263,            /* ENDPROCEDURE  */
-    RETURNS = 264,                 /* RETURNS  */
-    RETURN = 265,                  /* RETURN  */
-    CALL = 266,                    /* CALL  */
-    DECLARE = 267,                 /* DECLARE  */
-    ASSIGN = 268,                  /* ASSIGN  */
-    INTEGER = 269,                 /* INTEGER  */
-    REAL = 270,                    /* REAL  */
-    IF = 271,                      /* IF  */
-    THEN = 272,                    /* THEN  */
-    ELSE = 273,                    /* ELSE  */
-    ENDIF = 274,                   /* ENDIF  */
-    WHILE = 275,                   /* WHILE  */
-    ENDWHILE = 276,                /* ENDWHILE  */
-    FOR = 277,                     /* FOR  */
-    TO = 278,                      /* TO  */
-    NEXT = 279,                    /* NEXT  */
-    LE = 280,                      /* LE  */
-    GE = 281,                      /* GE  */
-    NE = 282,                      /* NE  */
-    MOD = 283,                     /* MOD  */
-    AND = 284,                     /* AND  */
-    OR = 285,                      /* OR  */
-    NOT = 286,                     /* NOT  */
-    NUMBER_CONST = 287,            /* NUMBER_CONST  */
-    UNARY = 288                    /* UNARY  */
-  };
-  typedef enum yytokentype yytoken_kind_t;
-#endif
-
-/* Value type.  */
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-union YYSTYPE
-{
-#line 28 "parser.y"
-
-    std::string *str_val;
-    int int_val;
-    double real_val;
-    BaseAST *ast_val;
-    BlockAST *block_val;
-    StmtAST *stmt_val;
-    ExprAST *expr_val;
-
-#line 117 "parser.tab.hpp"
-
-};
-typedef union YYSTYPE YYSTYPE;
-# define YYSTYPE_IS_TRIVIAL 1
-# define YYSTYPE_IS_DECLARED 1
-#endif
-
-
-extern YYSTYPE yylval;
-
-
-int yyparse (unique_ptr<BaseAST> &ast);
-
-
-#endif /* !YY_YY_PARSER_TAB_HPP_INCLUDED  */
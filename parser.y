@@ -1,4 +1,6 @@
 %define parse.error verbose
+%locations
+%define api.location.type {SourceRange}
 
 %code requires {
     #include <iostream>
@@ -6,6 +8,7 @@
     #include <string>
     #include <vector>
     #include "AST.h"
+    #include "Source.h"
 }
 
 %{
@@ -15,16 +18,57 @@
 #include <string>
 #include <vector>
 #include "AST.h"
+#include "Stats.h"
 
 int yylex();
 void yyerror(unique_ptr<BaseAST> &ast, const char *msg);
 
 using namespace std;
 
+// 产生式的位置从第一个符号的开始到最后一个符号的结束; 空产生式取前一个符号的结束
+#define YYLLOC_DEFAULT(Current, Rhs, N) \
+    do { \
+        if (N) { \
+            (Current).begin = YYRHSLOC(Rhs, 1).begin; \
+            (Current).end = YYRHSLOC(Rhs, N).end; \
+        } else { \
+            (Current).begin = (Current).end = YYRHSLOC(Rhs, 0).end; \
+        } \
+    } while (0)
+
+// 正在解析的源文件, 错误信息由它把偏移换算成行号和列号
+const SourceFile *parseSource = nullptr;
+
+// 本次解析的错误数 (含词法错误), 由 parseFile 清零; 不为零时不使用 AST
+int parseErrors = 0;
+
+// --stats: 词法分析穿插在语法分析中, 每次取记号的开销单独计入 lex
+static int timedLex() {
+    // 错误数达到 --error-limit 后假装文件已经结束, 解析随即停止
+    if (options.errorLimit > 0 && parseErrors >= options.errorLimit)
+        return 0;
+    PhaseTimer timer(PHASE_LEX);
+    return yylex();
+}
+#define yylex timedLex
+
+// 每个运算符单独一条产生式, 优先级和结合性声明才能生效
+static ExprAST* newBinaryExpr(ExprAST* lhs, const char *op, ExprAST* rhs, SourceRange range) {
+    auto ast = new BinaryExprAST();
+    ast->range = range;
+    ast->lhs = unique_ptr<ExprAST>(lhs);
+    ast->op = op;
+    ast->rhs = unique_ptr<ExprAST>(rhs);
+    return ast;
+}
+
 %}
 
 %parse-param { unique_ptr<BaseAST> &ast }
 
+/* 错误恢复时弹出的 AST; 记号的字符串不回收, 否则每个没有用到值的关键字都要写 delete */
+%destructor { delete $$; } <ast_val> <block_val> <stmt_val> <expr_val> <exprs_val> <fields_val> <param_val> <params_val> <bounds_val>
+
 %union {
     std::string *str_val;
     int int_val;
@@ -33,78 +77,196 @@ using namespace std;
     BlockAST *block_val;
     StmtAST *stmt_val;
     ExprAST *expr_val;
+    ExprList *exprs_val;
+    FieldList *fields_val;
+    ParamAST *param_val;
+    ParamList *params_val;
+    BoundList *bounds_val;
 }
 
-%token <str_val> OUTPUT
-%token <str_val> IDENT FUNCTION ENDFUNCTION PROCEDURE ENDPROCEDURE RETURNS RETURN CALL
-%token <str_val> DECLARE ASSIGN INTEGER REAL
+%token <str_val> OUTPUT INPUT
+%token <str_val> IDENT FUNCTION ENDFUNCTION PROCEDURE ENDPROCEDURE RETURNS RETURN CALL BYVAL BYREF
+%token <str_val> DECLARE ASSIGN INTEGER REAL STRING CHAR BOOLEAN
+%token <str_val> TYPE ENDTYPE ARRAY OF
 %token <str_val> IF THEN ELSE ENDIF WHILE ENDWHILE FOR TO NEXT
 %token <str_val> LE GE NE MOD AND OR NOT
-/* %token <int_val> INT_CONST */
+%token <int_val> INT_CONST
 %token <real_val> NUMBER_CONST
+%token <str_val> STRING_CONST CHAR_CONST
 
-%type <ast_val> FuncDef ProcDef
+%type <ast_val> Unit FuncDef ProcDef TypeDef
 %type <block_val> Block
 /* Stmt and Expr act as mid */
-%type <stmt_val> Stmt Output Return VarDecl VarAssign If While For
-%type <expr_val> Expr Number VarExpr PrimaryExpr UnaryExpr BinaryExpr
-%type <str_val> BinaryOp UnaryOp VarType
+%type <stmt_val> Stmt Output Input Call Return VarDecl ArrDecl VarAssign If While For
+%type <expr_val> Expr Number String Char VarExpr LVal CallExpr PrimaryExpr UnaryExpr BinaryExpr
+%type <exprs_val> Exprs
+%type <fields_val> Fields
+%type <param_val> Param
+%type <params_val> Params
+%type <bounds_val> Bounds
+%type <str_val> UnaryOp VarType
 
 %left OR
 %left AND
 %left '=' NE
 %left '<' '>' LE GE
-%left '+' '-'
+%left '+' '-' '&'
 %left '*' '/' MOD
 %right UNARY
 
 %%
 
+/* 出错的 Unit 和 Stmt 的值为 nullptr, 不放进 AST */
 CompUnit
-    : FuncDef {
+    : Unit {
         auto comp_unit = make_unique<CompUnitAST>();
-        comp_unit->def = unique_ptr<BaseAST>($1);
+        comp_unit->range = @$;
+        if ($1)
+            comp_unit->defs.push_back(unique_ptr<BaseAST>($1));
         ast = std::move(comp_unit);
     }
-    | ProcDef {
-        auto comp_unit = make_unique<CompUnitAST>();
-        comp_unit->def = unique_ptr<BaseAST>($1);
-        ast = std::move(comp_unit);
-    }
-    | Block {
-        auto comp_unit = make_unique<CompUnitAST>();
-        comp_unit->def = unique_ptr<BaseAST>($1);
-        ast = std::move(comp_unit);
+    | CompUnit Unit {
+        ast->range.end = @2.end;
+        if ($2)
+            static_cast<CompUnitAST *>(ast.get())->defs.push_back(unique_ptr<BaseAST>($2));
     }
     ;
 
+Unit
+    : FuncDef
+    | ProcDef
+    | TypeDef
+    | Stmt { $$ = $1; }
+    ;
+
 FuncDef
     : FUNCTION IDENT '(' ')' RETURNS VarType Block ENDFUNCTION {
         auto ast = new FuncDefAST();
+        ast->range = @$;
         ast->ident = *unique_ptr<string>($2);
         ast->type = *unique_ptr<string>($6);
         ast->block = unique_ptr<BaseAST>($7);
         $$ = ast;
     }
+    | FUNCTION IDENT '(' Params ')' RETURNS VarType Block ENDFUNCTION {
+        auto ast = new FuncDefAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->params = unique_ptr<ParamList>($4);
+        ast->type = *unique_ptr<string>($7);
+        ast->block = unique_ptr<BaseAST>($8);
+        $$ = ast;
+    }
+    /* 首部出错时跳到 ENDFUNCTION, 函数体中的错误由 Stmt 恢复 */
+    | FUNCTION error ENDFUNCTION { $$ = nullptr; }
     ;
 
 ProcDef
     : PROCEDURE IDENT '(' ')' Block ENDPROCEDURE {
         auto ast = new ProcDefAST();
+        ast->range = @$;
         ast->ident = *unique_ptr<string>($2);
         ast->block = unique_ptr<BaseAST>($5);
         $$ = ast;
     }
+    | PROCEDURE IDENT '(' Params ')' Block ENDPROCEDURE {
+        auto ast = new ProcDefAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->params = unique_ptr<ParamList>($4);
+        ast->block = unique_ptr<BaseAST>($6);
+        $$ = ast;
+    }
+    | PROCEDURE error ENDPROCEDURE { $$ = nullptr; }
+    ;
+
+Params
+    : Param {
+        $$ = new ParamList();
+        $$->push_back(unique_ptr<ParamAST>($1));
+    }
+    | Params ',' Param {
+        $1->push_back(unique_ptr<ParamAST>($3));
+        $$ = $1;
+    }
+    ;
+
+Param
+    : IDENT ':' VarType {
+        auto ast = new ParamAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($1);
+        ast->type = *unique_ptr<string>($3);
+        $$ = ast;
+    }
+    | BYVAL IDENT ':' VarType {
+        auto ast = new ParamAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->type = *unique_ptr<string>($4);
+        $$ = ast;
+    }
+    | BYREF IDENT ':' VarType {
+        auto ast = new ParamAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->type = *unique_ptr<string>($4);
+        ast->byRef = true;
+        $$ = ast;
+    }
+    ;
+
+TypeDef
+    : TYPE IDENT Fields ENDTYPE {
+        auto ast = new TypeDefAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->fields = unique_ptr<FieldList>($3);
+        $$ = ast;
+    }
+    | TYPE error ENDTYPE { $$ = nullptr; }
+    ;
+
+Fields
+    : VarDecl {
+        $$ = new FieldList();
+        $$->push_back(unique_ptr<VarDeclAST>(static_cast<VarDeclAST *>($1)));
+    }
+    | IDENT ':' VarType {
+        auto ast = new VarDeclAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($1);
+        ast->type = *unique_ptr<string>($3);
+        $$ = new FieldList();
+        $$->push_back(unique_ptr<VarDeclAST>(ast));
+    }
+    | Fields VarDecl {
+        $1->push_back(unique_ptr<VarDeclAST>(static_cast<VarDeclAST *>($2)));
+        $$ = $1;
+    }
+    | Fields IDENT ':' VarType {
+        auto ast = new VarDeclAST();
+        ast->range = { @2.begin, @4.end };
+        ast->ident = *unique_ptr<string>($2);
+        ast->type = *unique_ptr<string>($4);
+        $1->push_back(unique_ptr<VarDeclAST>(ast));
+        $$ = $1;
+    }
     ;
 
 Block
     : Stmt {
         auto ast = new BlockAST();
-        ast->stmts->push_back(unique_ptr<StmtAST>($1));
+        ast->range = @$;
+        if ($1)
+            ast->stmts->push_back(unique_ptr<StmtAST>($1));
         $$ = ast;
     }
     | Block Stmt {
-        $1->stmts->push_back(unique_ptr<StmtAST>($2));
+        $1->range.end = @2.end;
+        if ($2)
+            $1->stmts->push_back(unique_ptr<StmtAST>($2));
+        $$ = $1;
     }
     ;
 
@@ -117,24 +279,91 @@ Expr
 VarExpr
     : IDENT {
         auto ast = new VarExprAST();
+        ast->range = @$;
         ast->ident = *unique_ptr<string>($1);
         $$ = ast;
     }
     ;
 
+LVal
+    : VarExpr
+    | IDENT '[' Exprs ']' {
+        auto ast = new IndexExprAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($1);
+        ast->indexes = std::move(*unique_ptr<ExprList>($3));
+        $$ = ast;
+    }
+    | LVal '.' IDENT {
+        auto ast = new FieldExprAST();
+        ast->range = @$;
+        ast->base = unique_ptr<ExprAST>($1);
+        ast->field = *unique_ptr<string>($3);
+        $$ = ast;
+    }
+    ;
+
+Exprs
+    : Expr {
+        $$ = new ExprList();
+        $$->push_back(unique_ptr<ExprAST>($1));
+    }
+    | Exprs ',' Expr {
+        $1->push_back(unique_ptr<ExprAST>($3));
+        $$ = $1;
+    }
+    ;
+
+CallExpr
+    : IDENT '(' ')' {
+        auto ast = new CallExprAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($1);
+        $$ = ast;
+    }
+    | IDENT '(' Exprs ')' {
+        auto ast = new CallExprAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($1);
+        ast->args = std::move(*unique_ptr<ExprList>($3));
+        $$ = ast;
+    }
+    ;
+
 PrimaryExpr
-    : VarExpr {
+    : LVal {
         auto ast = new PrimaryExprAST();
+        ast->range = @$;
         ast->expr = unique_ptr<ExprAST>($1);
         $$ = ast;
     }
     | Number {
         auto ast = new PrimaryExprAST();
+        ast->range = @$;
+        ast->expr = unique_ptr<ExprAST>($1);
+        $$ = ast;
+    }
+    | CallExpr {
+        auto ast = new PrimaryExprAST();
+        ast->range = @$;
+        ast->expr = unique_ptr<ExprAST>($1);
+        $$ = ast;
+    }
+    | String {
+        auto ast = new PrimaryExprAST();
+        ast->range = @$;
+        ast->expr = unique_ptr<ExprAST>($1);
+        $$ = ast;
+    }
+    | Char {
+        auto ast = new PrimaryExprAST();
+        ast->range = @$;
         ast->expr = unique_ptr<ExprAST>($1);
         $$ = ast;
     }
     | '(' Expr ')' {
         auto ast = new PrimaryExprAST();
+        ast->range = @$;
         ast->expr = unique_ptr<ExprAST>($2);
         $$ = ast;
     }
@@ -143,6 +372,7 @@ PrimaryExpr
 UnaryExpr
     : UnaryOp Expr %prec UNARY {
         auto ast = new UnaryExprAST();
+        ast->range = @$;
         ast->op = *unique_ptr<string>($1);
         ast->expr = unique_ptr<ExprAST>($2);
         $$ = ast;
@@ -156,52 +386,75 @@ UnaryOp
     ;
 
 BinaryExpr
-    : Expr BinaryOp Expr {
-        auto ast = new BinaryExprAST();
-        ast->lhs = unique_ptr<ExprAST>($1);
-        ast->op = *unique_ptr<string>($2);
-        ast->rhs = unique_ptr<ExprAST>($3);
-        $$ = ast;
-    }
-    ;
-
-BinaryOp
-    : '+' { $$ = new string("+"); }
-    | '-' { $$ = new string("-"); }
-    | '*' { $$ = new string("*"); }
-    | '/' { $$ = new string("/"); }
-    | MOD { $$ = new string("MOD"); }
-    | '=' { $$ = new string("="); }
-    | NE { $$ = new string("<>"); }
-    | '>' { $$ = new string(">"); }
-    | '<' { $$ = new string("<"); }
-    | LE { $$ = new string("<="); }
-    | GE { $$ = new string(">="); }
-    | AND { $$ = new string("AND"); }
-    | OR { $$ = new string("OR"); }
+    : Expr '+' Expr { $$ = newBinaryExpr($1, "+", $3, @$); }
+    | Expr '-' Expr { $$ = newBinaryExpr($1, "-", $3, @$); }
+    | Expr '*' Expr { $$ = newBinaryExpr($1, "*", $3, @$); }
+    | Expr '/' Expr { $$ = newBinaryExpr($1, "/", $3, @$); }
+    | Expr '&' Expr { $$ = newBinaryExpr($1, "&", $3, @$); }
+    | Expr MOD Expr { $$ = newBinaryExpr($1, "MOD", $3, @$); }
+    | Expr '=' Expr { $$ = newBinaryExpr($1, "=", $3, @$); }
+    | Expr NE Expr { $$ = newBinaryExpr($1, "<>", $3, @$); }
+    | Expr '>' Expr { $$ = newBinaryExpr($1, ">", $3, @$); }
+    | Expr '<' Expr { $$ = newBinaryExpr($1, "<", $3, @$); }
+    | Expr LE Expr { $$ = newBinaryExpr($1, "<=", $3, @$); }
+    | Expr GE Expr { $$ = newBinaryExpr($1, ">=", $3, @$); }
+    | Expr AND Expr { $$ = newBinaryExpr($1, "AND", $3, @$); }
+    | Expr OR Expr { $$ = newBinaryExpr($1, "OR", $3, @$); }
     ;
 
 Stmt
     : Output
+    | Input
+    | Call
     | Return
     | VarDecl
+    | ArrDecl
     | VarAssign
     | If
     | While
     | For
+    /* 语句出错时丢弃记号直到能开始下一条语句 (或结束所在的块) */
+    | error { $$ = nullptr; }
     ;
 
 Output
     : OUTPUT Expr {
         auto ast = new OutputAST();
+        ast->range = @$;
         ast->expr = unique_ptr<ExprAST>($2);
         $$ = ast;
     }
     ;
 
+Input
+    : INPUT LVal {
+        auto ast = new InputAST();
+        ast->range = @$;
+        ast->lval = unique_ptr<ExprAST>($2);
+        $$ = ast;
+    }
+    ;
+
+Call
+    : CALL IDENT '(' ')' {
+        auto ast = new CallAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        $$ = ast;
+    }
+    | CALL IDENT '(' Exprs ')' {
+        auto ast = new CallAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->args = std::move(*unique_ptr<ExprList>($4));
+        $$ = ast;
+    }
+    ;
+
 Return
     : RETURN Expr {
         auto ast = new ReturnAST();
+        ast->range = @$;
         ast->expr = unique_ptr<ExprAST>($2);
         $$ = ast;
     }
@@ -210,21 +463,50 @@ Return
 VarDecl
     : DECLARE IDENT ':' VarType {
         auto ast = new VarDeclAST();
+        ast->range = @$;
         ast->ident = *unique_ptr<string>($2);
         ast->type = *unique_ptr<string>($4);
         $$ = ast;
     }
     ;
 
+ArrDecl
+    : DECLARE IDENT ':' ARRAY '[' Bounds ']' OF VarType {
+        auto ast = new ArrDeclAST();
+        ast->range = @$;
+        ast->ident = *unique_ptr<string>($2);
+        ast->bounds = std::move(*unique_ptr<BoundList>($6));
+        ast->type = *unique_ptr<string>($9);
+        $$ = ast;
+    }
+    ;
+
+Bounds
+    : INT_CONST ':' INT_CONST {
+        $$ = new BoundList();
+        $$->push_back(make_pair($1, $3));
+    }
+    | Bounds ',' INT_CONST ':' INT_CONST {
+        $1->push_back(make_pair($3, $5));
+        $$ = $1;
+    }
+    ;
+
 VarType
     : INTEGER
     | REAL
+    | STRING
+    | CHAR
+    | BOOLEAN
+    /* TYPE 定义的记录 */
+    | IDENT
     ;
 
 VarAssign
-    : IDENT ASSIGN Expr {
+    : LVal ASSIGN Expr {
         auto ast = new VarAssignAST();
-        ast->ident = *unique_ptr<string>($1);
+        ast->range = @$;
+        ast->lval = unique_ptr<ExprAST>($1);
         ast->expr = unique_ptr<ExprAST>($3);
         $$ = ast;
     }
@@ -233,12 +515,14 @@ VarAssign
 If
     : IF Expr THEN Block ENDIF {
         auto ast = new IfAST();
+        ast->range = @$;
         ast->cond = unique_ptr<ExprAST>($2);
         ast->block = unique_ptr<BaseAST>($4);
         $$ = ast;
     }
     | IF Expr THEN Block ELSE Block ENDIF {
         auto ast = new IfAST();
+        ast->range = @$;
         ast->cond = unique_ptr<ExprAST>($2);
         ast->block = unique_ptr<BaseAST>($4);
         ast->hasElse = 1;
@@ -250,6 +534,7 @@ If
 While
     : WHILE Expr Block ENDWHILE {
         auto ast = new WhileAST();
+        ast->range = @$;
         ast->cond = unique_ptr<ExprAST>($2);
         ast->block = unique_ptr<BaseAST>($3);
         $$ = ast;
@@ -259,6 +544,7 @@ While
 For
     : FOR IDENT ASSIGN Expr TO Expr Block NEXT {
         auto ast = new ForAST();
+        ast->range = @$;
         ast->ident = *unique_ptr<string>($2);
         ast->exprFrom = unique_ptr<ExprAST>($4);
         ast->exprTo = unique_ptr<ExprAST>($6);
@@ -268,15 +554,48 @@ For
     ;
 
 Number
-    : NUMBER_CONST {
+    : INT_CONST {
+        auto ast = new IntAST();
+        ast->range = @$;
+        ast->value = $1;
+        $$ = ast;
+    }
+    | NUMBER_CONST {
         auto ast = new NumberAST();
+        ast->range = @$;
         ast->value = *unique_ptr<double>(new double($1));
         $$ = ast;
     }
     ;
 
+String
+    : STRING_CONST {
+        auto ast = new StringAST();
+        ast->range = @$;
+        ast->value = *unique_ptr<string>($1);
+        $$ = ast;
+    }
+    ;
+
+Char
+    : CHAR_CONST {
+        auto ast = new CharAST();
+        ast->range = @$;
+        ast->value = (*unique_ptr<string>($1))[0];
+        $$ = ast;
+    }
+    ;
+
 %%
 
+// 位置是出错的记号 (向前看的记号) 的位置
 void yyerror(unique_ptr<BaseAST> &ast, const char *msg) {
-    cerr << "\033[31;1m" << "error: " << msg << "\033[0m" << endl;
+    parseErrors++;
+    if (options.errorLimit > 0 && parseErrors > options.errorLimit)
+        return;
+    LineColumn position = parseSource->locate(yylloc.begin);
+    *diagnostics << "\033[31;1m" << "error: line " << position.line << ", column " << position.column
+                 << ": " << msg << "\033[0m" << endl;
+    if (parseErrors == options.errorLimit)
+        *diagnostics << "too many errors, stopping" << endl;
 }
@@ -0,0 +1,212 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "runtime.h"
+
+#define INPUT_BUFFER_SIZE (1 << 16)
+
+static char inputBuffer[INPUT_BUFFER_SIZE];
+static size_t inputPos, inputEnd;
+static int inputEOF;
+
+static int isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static void inputError(const char *msg) {
+    pc_flush();
+    fprintf(stderr, "runtime error: %s\n", msg);
+    exit(1);
+}
+
+// 未读部分移到缓冲区开头, 再 read 一次; 读之前写出 OUTPUT 缓冲, 交互时提示先于等待出现
+static int refill(void) {
+    if (inputEOF)
+        return 0;
+    pc_flush();
+    memmove(inputBuffer, inputBuffer + inputPos, inputEnd - inputPos);
+    inputEnd -= inputPos;
+    inputPos = 0;
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, inputBuffer + inputEnd, INPUT_BUFFER_SIZE - inputEnd);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            inputEOF = 1;
+            return 0;
+        }
+        inputEnd += n;
+        return 1;
+    }
+}
+
+// 下一个以空白分隔的 token, 保证整个 token 连续地在缓冲区中
+static const char *nextToken(size_t *length) {
+    for (;;) {
+        while (inputPos < inputEnd && isSpace(inputBuffer[inputPos]))
+            inputPos++;
+        if (inputPos < inputEnd)
+            break;
+        if (!refill())
+            inputError("unexpected end of input");
+    }
+
+    size_t scanned = 0;
+    for (;;) {
+        while (inputPos + scanned < inputEnd && !isSpace(inputBuffer[inputPos + scanned]))
+            scanned++;
+        // 比整个缓冲区还长的 token 截断处理
+        if (inputPos + scanned < inputEnd || scanned == INPUT_BUFFER_SIZE || !refill())
+            break;
+    }
+    const char *token = inputBuffer + inputPos;
+    inputPos += scanned;
+    *length = scanned;
+    return token;
+}
+
+void pc_input_string(pc_string *out) {
+    for (;;) {
+        while (inputPos < inputEnd && isSpace(inputBuffer[inputPos]))
+            inputPos++;
+        if (inputPos < inputEnd)
+            break;
+        if (!refill())
+            inputError("unexpected end of input");
+    }
+
+    size_t scanned = 0;
+    for (;;) {
+        const char *start = inputBuffer + inputPos + scanned;
+        const char *newline = memchr(start, '\n', inputEnd - inputPos - scanned);
+        if (newline) {
+            scanned = newline - (inputBuffer + inputPos);
+            break;
+        }
+        scanned = inputEnd - inputPos;
+        if (scanned == INPUT_BUFFER_SIZE || !refill())
+            break;
+    }
+    size_t length = scanned;
+    if (length > 0 && inputBuffer[inputPos + length - 1] == '\r')
+        length--;
+    pc_string_copy(out, inputBuffer + inputPos, length);
+    inputPos += scanned;
+}
+
+int64_t pc_input_int(void) {
+    size_t length;
+    const char *p = nextToken(&length);
+    const char *end = p + length;
+    int negative = 0;
+    if (*p == '-' || *p == '+')
+        negative = *p++ == '-';
+    if (p == end)
+        inputError("invalid INTEGER input");
+
+    uint64_t value = 0;
+    for (; p < end; p++) {
+        unsigned digit = (unsigned char)*p - '0';
+        if (digit > 9)
+            inputError("invalid INTEGER input");
+        value = value * 10 + digit;
+    }
+    return negative ? -(int64_t)value : (int64_t)value;
+}
+
+static const double exactPowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// 有效数字 <= 2^53 且 |10 的指数| <= 22 时一次乘/除即是正确舍入的结果 (Clinger),
+// 其余情况交给 strtod
+double pc_input_real(void) {
+    size_t length;
+    const char *token = nextToken(&length);
+    const char *p = token, *end = token + length;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0, exact = 1, seenDigit = 0;
+    for (; p < end && (unsigned)(*p - '0') <= 9; p++) {
+        seenDigit = 1;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+            exact = 0;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && (unsigned)(*p - '0') <= 9; p++) {
+            seenDigit = 1;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            } else {
+                exact = 0;
+            }
+        }
+    }
+    if (seenDigit && p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int expNegative = 0, expValue = 0;
+        if (q < end && (*q == '-' || *q == '+'))
+            expNegative = *q++ == '-';
+        if (q < end && (unsigned)(*q - '0') <= 9) {
+            for (; q < end && (unsigned)(*q - '0') <= 9; q++) {
+                if (expValue < 10000)
+                    expValue = expValue * 10 + (*q - '0');
+            }
+            exponent += expNegative ? -expValue : expValue;
+            p = q;
+        }
+    }
+    if (!seenDigit || p != end)
+        inputError("invalid REAL input");
+
+    if (exact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / exactPowersOf10[-exponent] : value * exactPowersOf10[exponent];
+        return negative ? -value : value;
+    }
+
+    char buf[128];
+    char *copy = length < sizeof(buf) ? buf : malloc(length + 1);
+    memcpy(copy, token, length);
+    copy[length] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != buf)
+        free(copy);
+    return value;
+}
+
+int32_t pc_input_bool(void) {
+    size_t length;
+    const char *token = nextToken(&length);
+    if (length == 4 && !strncasecmp(token, "TRUE", 4))
+        return 1;
+    if (length == 5 && !strncasecmp(token, "FALSE", 5))
+        return 0;
+    inputError("invalid BOOLEAN input");
+    return 0;
+}
+
+char pc_input_char(void) {
+    for (;;) {
+        while (inputPos < inputEnd && isSpace(inputBuffer[inputPos]))
+            inputPos++;
+        if (inputPos < inputEnd)
+            return inputBuffer[inputPos++];
+        if (!refill())
+            inputError("unexpected end of input");
+    }
+}
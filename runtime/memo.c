@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime.h"
+
+#define MEMO_MIN_CAPACITY 1024
+// 参数范围很大时不再插入新项, 避免缓存耗尽内存
+#define MEMO_MAX_ENTRIES (1 << 22)
+
+// 开放定址的哈希表, 每项依次是: 结果 (8 字节), 是否占用 (4 字节), 各参数
+struct pc_memo {
+    const char *name;
+    int32_t nargs;
+    size_t entrySize;
+    size_t capacity, size;
+    char *entries;
+    uint64_t calls, hits;
+    struct pc_memo *next;
+};
+
+static pc_memo *memoTables, **memoTail = &memoTables;
+
+static void *memoAlloc(size_t size) {
+    void *p = calloc(1, size);
+    if (!p) {
+        pc_flush();
+        fprintf(stderr, "runtime error: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void memoReport(void) {
+    fprintf(stderr, "memoization report:\n");
+    for (pc_memo *memo = memoTables; memo; memo = memo->next) {
+        double rate = memo->calls ? 100.0 * memo->hits / memo->calls : 0.0;
+        fprintf(stderr, "  %s: %llu calls, %llu hits (%.1f%%), %zu entries\n", memo->name,
+                (unsigned long long)memo->calls, (unsigned long long)memo->hits, rate, memo->size);
+    }
+}
+
+static uint64_t hashArgs(const int32_t *args, int32_t nargs) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (int32_t i = 0; i < nargs; i++) {
+        h ^= (uint32_t)args[i];
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// args 所在的项, 或者应插入的空项
+static char *findEntry(pc_memo *memo, const int32_t *args) {
+    size_t argsSize = memo->nargs * sizeof(int32_t);
+    size_t mask = memo->capacity - 1;
+    for (size_t i = hashArgs(args, memo->nargs) & mask;; i = (i + 1) & mask) {
+        char *entry = memo->entries + i * memo->entrySize;
+        int32_t used;
+        memcpy(&used, entry + 8, sizeof(used));
+        if (!used || memcmp(entry + 12, args, argsSize) == 0)
+            return entry;
+    }
+}
+
+static void growTable(pc_memo *memo) {
+    char *old = memo->entries;
+    size_t oldCapacity = memo->capacity;
+    memo->capacity = oldCapacity ? oldCapacity * 2 : MEMO_MIN_CAPACITY;
+    memo->entries = memoAlloc(memo->capacity * memo->entrySize);
+    for (size_t i = 0; i < oldCapacity; i++) {
+        char *entry = old + i * memo->entrySize;
+        int32_t used;
+        memcpy(&used, entry + 8, sizeof(used));
+        if (used)
+            memcpy(findEntry(memo, (const int32_t *)(entry + 12)), entry, memo->entrySize);
+    }
+    free(old);
+}
+
+int32_t pc_memo_lookup(pc_memo **table, const char *name, int32_t nargs, const int32_t *args, int64_t *value) {
+    pc_memo *memo = *table;
+    if (!memo) {
+        memo = *table = memoAlloc(sizeof(pc_memo));
+        memo->name = name;
+        memo->nargs = nargs;
+        memo->entrySize = (12 + nargs * sizeof(int32_t) + 7) & ~(size_t)7;
+        growTable(memo);
+        if (!memoTables && getenv("PC_MEMO_REPORT"))
+            atexit(memoReport);
+        *memoTail = memo;
+        memoTail = &memo->next;
+    }
+
+    memo->calls++;
+    char *entry = findEntry(memo, args);
+    int32_t used;
+    memcpy(&used, entry + 8, sizeof(used));
+    if (!used)
+        return 0;
+    memo->hits++;
+    memcpy(value, entry, sizeof(*value));
+    return 1;
+}
+
+void pc_memo_store(pc_memo **table, const int32_t *args, int64_t value) {
+    pc_memo *memo = *table;
+    if (memo->size >= MEMO_MAX_ENTRIES)
+        return;
+    if ((memo->size + 1) * 2 > memo->capacity)
+        growTable(memo);
+
+    char *entry = findEntry(memo, args);
+    int32_t used;
+    memcpy(&used, entry + 8, sizeof(used));
+    if (!used) {
+        used = 1;
+        memcpy(entry + 8, &used, sizeof(used));
+        memcpy(entry + 12, args, memo->nargs * sizeof(int32_t));
+        memo->size++;
+    }
+    memcpy(entry, &value, sizeof(value));
+}
@@ -0,0 +1,168 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "runtime.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+static char outputBuffer[OUTPUT_BUFFER_SIZE];
+static size_t outputLength;
+
+static void writeAll(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+void pc_flush(void) {
+    writeAll(outputBuffer, outputLength);
+    outputLength = 0;
+}
+
+// 保证缓冲区还有 length 字节可写
+static char *reserve(size_t length) {
+    if (outputLength + length > OUTPUT_BUFFER_SIZE)
+        pc_flush();
+    return outputBuffer + outputLength;
+}
+
+static void append(const char *data, size_t length) {
+    if (length > OUTPUT_BUFFER_SIZE) {
+        pc_flush();
+        writeAll(data, length);
+        return;
+    }
+    memcpy(reserve(length), data, length);
+    outputLength += length;
+}
+
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// 从 end 往前写十进制数字, 每次两位, 返回首字符位置
+static char *formatUnsigned(char *end, uint64_t value) {
+    while (value >= 100) {
+        const char *pair = digitPairs + (value % 100) * 2;
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (value >= 10) {
+        const char *pair = digitPairs + value * 2;
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = '0' + value;
+    }
+    return end;
+}
+
+void pc_output_int(int64_t value) {
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    char *start = formatUnsigned(end, magnitude);
+    if (value < 0)
+        *--start = '-';
+    append(start, end - start);
+}
+
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+};
+
+// 找最小的 k 使 value == m / 10^k 且 |m| < 2^53: m 与 10^k 都能精确表示,
+// 除法结果与 strtod 对 "m e-k" 的舍入一致, 因此这就是可往返的最短小数形式
+static int formatShortDecimal(char *buf, double value) {
+    for (int k = 0; k < (int)(sizeof(powersOf10) / sizeof(powersOf10[0])); k++) {
+        double scaled = value * powersOf10[k];
+        if (!(scaled > -9007199254740992.0 && scaled < 9007199254740992.0))
+            return 0;
+        int64_t m = (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+        if ((double)m / powersOf10[k] != value)
+            continue;
+
+        char digits[24];
+        char *end = digits + sizeof(digits);
+        char *start = formatUnsigned(end, m < 0 ? -(uint64_t)m : (uint64_t)m);
+        int length = end - start;
+        char *out = buf;
+        if (value < 0 || (value == 0 && 1 / value < 0))
+            *out++ = '-';
+        if (k == 0) {
+            memcpy(out, start, length);
+            out += length;
+            *out++ = '.';
+            *out++ = '0';
+        } else if (length > k) {
+            memcpy(out, start, length - k);
+            out += length - k;
+            *out++ = '.';
+            memcpy(out, start + length - k, k);
+            out += k;
+        } else {
+            *out++ = '0';
+            *out++ = '.';
+            memset(out, '0', k - length);
+            out += k - length;
+            memcpy(out, start, length);
+            out += length;
+        }
+        return out - buf;
+    }
+    return 0;
+}
+
+void pc_output_real(double value) {
+    char buf[40];
+    int length = formatShortDecimal(buf, value);
+    if (!length) {
+        // 很大, 很小或有效数字很多的数: 取 15..17 位中最短的可往返表示
+        for (int precision = 15; precision <= 17; precision++) {
+            length = snprintf(buf, sizeof(buf), "%.*g", precision, value);
+            if (strtod(buf, NULL) == value)
+                break;
+        }
+    }
+    append(buf, length);
+}
+
+void pc_output_bool(int32_t value) {
+    if (value)
+        append("TRUE", 4);
+    else
+        append("FALSE", 5);
+}
+
+void pc_output_char(char value) {
+    *reserve(1) = value;
+    outputLength++;
+}
+
+void pc_output_string(const pc_string *value) {
+    append(pc_string_data(value), pc_string_length(value));
+}
+
+void pc_output_newline(void) {
+    *reserve(1) = '\n';
+    outputLength++;
+}
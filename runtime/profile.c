@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime.h"
+
+#define PROFILE_DEFAULT_OUT "pcprofile.txt"
+#define PROFILE_HOTTEST 20
+
+// 编译器生成的表: 第 i 条语句在 lines[i] 行, 执行了 counts[i] 次
+static const char *profileSource;
+static const int32_t *profileLines;
+static const uint64_t *profileCounts;
+static int32_t profileSize;
+
+typedef struct {
+    int32_t line;
+    uint64_t count;
+} LineCount;
+
+static int compareHotness(const void *a, const void *b) {
+    const LineCount *x = a, *y = b;
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return x->line - y->line;
+}
+
+// 读入整个源文件并按行切开, lines[i] 是第 i + 1 行; 读不到时返回 0 行
+static int32_t readSource(const char *path, char ***lines) {
+    *lines = NULL;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    size_t size = 0, capacity = 4096;
+    char *text = malloc(capacity);
+    for (size_t n; text && (n = fread(text + size, 1, capacity - size - 1, file)) > 0;) {
+        size += n;
+        if (capacity - size == 1)
+            text = realloc(text, capacity *= 2);
+    }
+    fclose(file);
+    if (!text)
+        return 0;
+    text[size] = '\0';
+
+    int32_t count = 0, capacityLines = 256;
+    *lines = malloc(capacityLines * sizeof(char *));
+    for (char *p = text; *lines && *p;) {
+        if (count == capacityLines)
+            *lines = realloc(*lines, (capacityLines *= 2) * sizeof(char *));
+        (*lines)[count++] = p;
+        char *end = strchr(p, '\n');
+        if (!end)
+            break;
+        *end = '\0';
+        if (end > p && end[-1] == '\r')
+            end[-1] = '\0';
+        p = end + 1;
+    }
+    return *lines ? count : 0;
+}
+
+static const char *sourceLine(char **lines, int32_t nlines, int32_t line) {
+    return line >= 1 && line <= nlines ? lines[line - 1] : "";
+}
+
+static void writeProfile(void) {
+    const char *path = getenv("PC_PROFILE_OUT");
+    if (!path)
+        path = PROFILE_DEFAULT_OUT;
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "runtime error: cannot write profile to %s\n", path);
+        return;
+    }
+
+    char **lines;
+    int32_t nlines = readSource(profileSource, &lines);
+    int32_t maxLine = nlines;
+    for (int32_t i = 0; i < profileSize; i++) {
+        if (profileLines[i] > maxLine)
+            maxLine = profileLines[i];
+    }
+
+    // 同一行上的多条语句合并; hasStmt 区分没有语句的行与从未执行的行
+    uint64_t *counts = calloc(maxLine + 1, sizeof(uint64_t));
+    char *hasStmt = calloc(maxLine + 1, 1);
+    LineCount *hottest = calloc(maxLine + 1, sizeof(LineCount));
+    if (!counts || !hasStmt || !hottest) {
+        fclose(out);
+        return;
+    }
+    uint64_t total = 0;
+    for (int32_t i = 0; i < profileSize; i++) {
+        counts[profileLines[i]] += profileCounts[i];
+        hasStmt[profileLines[i]] = 1;
+        total += profileCounts[i];
+    }
+
+    int32_t nhot = 0;
+    for (int32_t line = 1; line <= maxLine; line++) {
+        if (counts[line]) {
+            hottest[nhot].line = line;
+            hottest[nhot].count = counts[line];
+            nhot++;
+        }
+    }
+    qsort(hottest, nhot, sizeof(LineCount), compareHotness);
+
+    fprintf(out, "profile of %s: %llu statements executed\n\n", profileSource, (unsigned long long)total);
+    fprintf(out, "hottest lines\n%12s %8s %6s  %s\n", "count", "percent", "line", "source");
+    for (int32_t i = 0; i < nhot && i < PROFILE_HOTTEST; i++) {
+        fprintf(out, "%12llu %7.2f%% %6d  %s\n", (unsigned long long)hottest[i].count,
+                100.0 * hottest[i].count / total, hottest[i].line,
+                sourceLine(lines, nlines, hottest[i].line));
+    }
+
+    fprintf(out, "\nannotated source\n%12s %6s  %s\n", "count", "line", "source");
+    for (int32_t line = 1; line <= maxLine; line++) {
+        if (hasStmt[line])
+            fprintf(out, "%12llu %6d  %s\n", (unsigned long long)counts[line], line, sourceLine(lines, nlines, line));
+        else
+            fprintf(out, "%12s %6d  %s\n", "", line, sourceLine(lines, nlines, line));
+    }
+    fclose(out);
+}
+
+void pc_profile_register(const char *source, const int32_t *lines, const uint64_t *counts, int32_t size) {
+    profileSource = source;
+    profileLines = lines;
+    profileCounts = counts;
+    profileSize = size;
+    atexit(writeProfile);
+}
@@ -0,0 +1,100 @@
+#ifndef __PC_RUNTIME_H__
+#define __PC_RUNTIME_H__
+
+// 生成的程序链接的运行时库, 由 CodeGen.cpp 按名字调用
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// STRING: 16 字节的值, 最后一个字节是标记.
+// 不超过 15 字节的字符串直接存在值里 (标记即长度), 记录中的短 STRING 字段不需要额外分配;
+// 更长的存指向 arena 或常量区的指针和长度 (标记为 PC_STRING_HEAP).
+// 全零即空串, 与 DECLARE 后的初值一致.
+// 对应 IR 中的 %STRING = type { i64, i64 }
+#define PC_STRING_INLINE 15
+#define PC_STRING_TAG 15
+#define PC_STRING_HEAP 0x80
+
+typedef union {
+    char bytes[16];
+    struct {
+        const char *data;
+        uint32_t length;
+    } heap;
+} pc_string;
+
+static inline int pc_string_is_inline(const pc_string *s) {
+    return (unsigned char)s->bytes[PC_STRING_TAG] != PC_STRING_HEAP;
+}
+
+static inline size_t pc_string_length(const pc_string *s) {
+    return pc_string_is_inline(s) ? (unsigned char)s->bytes[PC_STRING_TAG] : s->heap.length;
+}
+
+static inline const char *pc_string_data(const pc_string *s) {
+    return pc_string_is_inline(s) ? s->bytes : s->heap.data;
+}
+
+void pc_string_literal(pc_string *out, const char *data, int64_t length);
+void pc_string_from_char(pc_string *out, char c);
+// 复制 data 到 arena (短串直接内联)
+void pc_string_copy(pc_string *out, const char *data, int64_t length);
+void pc_string_concat(pc_string *out, const pc_string *a, const pc_string *b);
+// memcmp 语义: <0, 0, >0
+int32_t pc_string_compare(const pc_string *a, const pc_string *b);
+// 从 arena 分配 size 字节
+char *pc_string_alloc(size_t size);
+
+// 字符串内置函数, 位置从 1 开始, FIND 找不到返回 0
+int64_t pc_length(const pc_string *s);
+void pc_mid(pc_string *out, const pc_string *s, int64_t start, int64_t length);
+void pc_left(pc_string *out, const pc_string *s, int64_t length);
+void pc_right(pc_string *out, const pc_string *s, int64_t length);
+void pc_ucase(pc_string *out, const pc_string *s);
+void pc_lcase(pc_string *out, const pc_string *s);
+int64_t pc_find_char(const pc_string *s, char c);
+int64_t pc_find(const pc_string *s, const pc_string *needle);
+
+// UCASE/LCASE 与查找的实现, 启动时选择 CPU 支持的最高一级; 基准测试可以手动指定
+enum { PC_SIMD_SCALAR, PC_SIMD_SSE2, PC_SIMD_AVX2 };
+// 返回实际选中的级别
+int pc_simd_select(int level);
+
+// OUTPUT: 写入进程内缓冲区, 满了或 pc_flush 时才 write(2)
+void pc_output_int(int64_t value);
+void pc_output_real(double value);
+void pc_output_bool(int32_t value);
+void pc_output_char(char value);
+void pc_output_string(const pc_string *value);
+void pc_output_newline(void);
+
+// main 返回前以及 INPUT 读 stdin 前调用
+void pc_flush(void);
+
+// INPUT: 整块 read(2) 到缓冲区, 按空白分隔解析
+int64_t pc_input_int(void);
+double pc_input_real(void);
+int32_t pc_input_bool(void);
+char pc_input_char(void);
+// 读入一行 (跳过行首空白)
+void pc_input_string(pc_string *out);
+
+// --memoize: 纯函数的结果按参数缓存, 查到返回 1 并写入 *value.
+// *table 初值为 NULL, 第一次查找时创建; 设置环境变量 PC_MEMO_REPORT 时退出前报告命中率
+typedef struct pc_memo pc_memo;
+int32_t pc_memo_lookup(pc_memo **table, const char *name, int32_t nargs, const int32_t *args, int64_t *value);
+void pc_memo_store(pc_memo **table, const int32_t *args, int64_t value);
+
+// --profile: main 开始时登记每条语句的行号和计数器, 退出时把按热度排序的源代码清单
+// 写入 PC_PROFILE_OUT (默认 pcprofile.txt)
+void pc_profile_register(const char *source, const int32_t *lines, const uint64_t *counts, int32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime.h"
+
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// 程序运行期间的字符串都分配在 arena 中, 从不单独释放
+static char *arenaTop, *arenaEnd;
+
+char *pc_string_alloc(size_t size) {
+    if ((size_t)(arenaEnd - arenaTop) < size) {
+        // 新块至少是所需的两倍, 之后的拼接可以继续原地追加
+        size_t chunkSize = size * 2 > ARENA_CHUNK_SIZE ? size * 2 : ARENA_CHUNK_SIZE;
+        arenaTop = malloc(chunkSize);
+        if (!arenaTop) {
+            pc_flush();
+            fprintf(stderr, "runtime error: out of memory\n");
+            exit(1);
+        }
+        arenaEnd = arenaTop + chunkSize;
+    }
+    char *p = arenaTop;
+    arenaTop += size;
+    return p;
+}
+
+static void makeString(pc_string *out, const char *data, size_t length) {
+    pc_string result;
+    if (length <= PC_STRING_INLINE) {
+        memset(&result, 0, sizeof(result));
+        memcpy(result.bytes, data, length);
+        result.bytes[PC_STRING_TAG] = length;
+    } else {
+        result.heap.data = data;
+        result.heap.length = length;
+        result.bytes[PC_STRING_TAG] = PC_STRING_HEAP;
+    }
+    *out = result;
+}
+
+void pc_string_literal(pc_string *out, const char *data, int64_t length) {
+    // 长字面量直接引用常量区, 不复制
+    makeString(out, data, length);
+}
+
+void pc_string_from_char(pc_string *out, char c) {
+    makeString(out, &c, 1);
+}
+
+void pc_string_copy(pc_string *out, const char *data, int64_t length) {
+    if (length <= PC_STRING_INLINE) {
+        makeString(out, data, length);
+        return;
+    }
+    char *p = pc_string_alloc(length);
+    memcpy(p, data, length);
+    makeString(out, p, length);
+}
+
+// s & x: s 恰好结束在 arena 顶端时直接在其后追加, 循环里的 s <- s & x 是均摊线性的.
+// 共享同一数据的其它字符串长度不变, 看不到追加的字节, 因此这样做不破坏值语义
+void pc_string_concat(pc_string *out, const pc_string *a, const pc_string *b) {
+    const char *aData = pc_string_data(a), *bData = pc_string_data(b);
+    size_t aLength = pc_string_length(a), bLength = pc_string_length(b);
+    size_t length = aLength + bLength;
+
+    if (length <= PC_STRING_INLINE) {
+        char buf[PC_STRING_INLINE];
+        memcpy(buf, aData, aLength);
+        memcpy(buf + aLength, bData, bLength);
+        makeString(out, buf, length);
+        return;
+    }
+    if (!pc_string_is_inline(a) && aData + aLength == arenaTop && (size_t)(arenaEnd - arenaTop) >= bLength) {
+        memcpy(arenaTop, bData, bLength);
+        arenaTop += bLength;
+        makeString(out, aData, length);
+        return;
+    }
+    char *p = pc_string_alloc(length);
+    memcpy(p, aData, aLength);
+    memcpy(p + aLength, bData, bLength);
+    makeString(out, p, length);
+}
+
+int32_t pc_string_compare(const pc_string *a, const pc_string *b) {
+    size_t aLength = pc_string_length(a), bLength = pc_string_length(b);
+    int result = memcmp(pc_string_data(a), pc_string_data(b), aLength < bLength ? aLength : bLength);
+    if (result)
+        return result;
+    return (aLength > bLength) - (aLength < bLength);
+}
@@ -0,0 +1,217 @@
+#include <string.h>
+#include "runtime.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PC_X86 1
+#endif
+
+// 大小写转换: 把 [first, first + 25] 范围内的字母异或 0x20
+typedef void (*ConvertCaseFunction)(char *dst, const char *src, size_t length, char first);
+typedef const char *(*FindCharFunction)(const char *s, size_t length, char c);
+
+// 以下小步骤强制内联进各个实现, 使 AVX2 版本的尾部也用 VEX 编码, 避免 SSE/AVX 切换的开销
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+ALWAYS_INLINE void convertCaseTail(char *dst, const char *src, size_t length, char first) {
+    for (size_t i = 0; i < length; i++)
+        dst[i] = src[i] ^ (((unsigned char)(src[i] - first) < 26) << 5);
+}
+
+ALWAYS_INLINE const char *findCharTail(const char *s, size_t length, char c) {
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] == c)
+            return s + i;
+    }
+    return NULL;
+}
+
+static void convertCaseScalar(char *dst, const char *src, size_t length, char first) {
+    convertCaseTail(dst, src, length, first);
+}
+
+static const char *findCharScalar(const char *s, size_t length, char c) {
+    return findCharTail(s, length, c);
+}
+
+#ifdef PC_X86
+// 加上 0x80 - first 后字母落在 [-128, -103], 一次有符号比较即可判断
+ALWAYS_INLINE size_t convertCase16(char *dst, const char *src, size_t length, char first) {
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - first));
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i isLetter = _mm_cmplt_epi8(_mm_add_epi8(v, bias), limit);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, _mm_and_si128(isLetter, flip)));
+    }
+    return i;
+}
+
+// 找到则返回位置; 否则在 checked 中给出已检查的字节数, 余下的交给尾部
+ALWAYS_INLINE const char *findChar16(const char *s, size_t length, char c, size_t *checked) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+        if (mask)
+            return s + i + __builtin_ctz(mask);
+    }
+    *checked = i;
+    return NULL;
+}
+
+static void convertCaseSSE2(char *dst, const char *src, size_t length, char first) {
+    size_t i = convertCase16(dst, src, length, first);
+    convertCaseTail(dst + i, src + i, length - i, first);
+}
+
+static const char *findCharSSE2(const char *s, size_t length, char c) {
+    size_t i = 0;
+    const char *found = findChar16(s, length, c, &i);
+    return found ? found : findCharTail(s + i, length - i, c);
+}
+
+__attribute__((target("avx2")))
+static void convertCaseAVX2(char *dst, const char *src, size_t length, char first) {
+    const __m256i bias = _mm256_set1_epi8((char)(0x80 - first));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i isLetter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, _mm256_and_si256(isLetter, flip)));
+    }
+    i += convertCase16(dst + i, src + i, length - i, first);
+    convertCaseTail(dst + i, src + i, length - i, first);
+}
+
+__attribute__((target("avx2")))
+static const char *findCharAVX2(const char *s, size_t length, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+        if (mask)
+            return s + i + __builtin_ctz(mask);
+    }
+    size_t checked = 0;
+    const char *found = findChar16(s + i, length - i, c, &checked);
+    if (found)
+        return found;
+    i += checked;
+    return findCharTail(s + i, length - i, c);
+}
+#endif
+
+static ConvertCaseFunction convertCase = convertCaseScalar;
+static FindCharFunction findChar = findCharScalar;
+
+int pc_simd_select(int level) {
+#ifdef PC_X86
+    if (level >= PC_SIMD_AVX2 && __builtin_cpu_supports("avx2")) {
+        convertCase = convertCaseAVX2;
+        findChar = findCharAVX2;
+        return PC_SIMD_AVX2;
+    }
+    if (level >= PC_SIMD_SSE2) {
+        convertCase = convertCaseSSE2;
+        findChar = findCharSSE2;
+        return PC_SIMD_SSE2;
+    }
+#endif
+    convertCase = convertCaseScalar;
+    findChar = findCharScalar;
+    return PC_SIMD_SCALAR;
+}
+
+// 程序启动时按 CPU 选择实现
+__attribute__((constructor))
+static void selectSimd(void) {
+#ifdef PC_X86
+    __builtin_cpu_init();
+#endif
+    pc_simd_select(PC_SIMD_AVX2);
+}
+
+int64_t pc_length(const pc_string *s) {
+    return pc_string_length(s);
+}
+
+// 下标从 1 开始; 越界部分截掉而不报错, 因此这些函数只读写参数
+void pc_mid(pc_string *out, const pc_string *s, int64_t start, int64_t length) {
+    int64_t size = pc_string_length(s);
+    if (start < 1) {
+        length += start - 1;
+        start = 1;
+    }
+    if (start > size || length <= 0) {
+        start = 1;
+        length = 0;
+    } else if (length > size - start + 1)
+        length = size - start + 1;
+    // 子串共享原字符串的数据
+    pc_string_literal(out, pc_string_data(s) + start - 1, length);
+}
+
+void pc_left(pc_string *out, const pc_string *s, int64_t length) {
+    pc_mid(out, s, 1, length);
+}
+
+void pc_right(pc_string *out, const pc_string *s, int64_t length) {
+    int64_t size = pc_string_length(s);
+    if (length > size)
+        length = size;
+    pc_mid(out, s, size - length + 1, length);
+}
+
+static void convertString(pc_string *out, const pc_string *s, char first) {
+    size_t length = pc_string_length(s);
+    if (length <= PC_STRING_INLINE) {
+        char buf[PC_STRING_INLINE];
+        convertCase(buf, pc_string_data(s), length, first);
+        pc_string_copy(out, buf, length);
+        return;
+    }
+    char *p = pc_string_alloc(length);
+    convertCase(p, pc_string_data(s), length, first);
+    pc_string_literal(out, p, length);
+}
+
+void pc_ucase(pc_string *out, const pc_string *s) {
+    convertString(out, s, 'a');
+}
+
+void pc_lcase(pc_string *out, const pc_string *s) {
+    convertString(out, s, 'A');
+}
+
+int64_t pc_find_char(const pc_string *s, char c) {
+    const char *data = pc_string_data(s);
+    const char *found = findChar(data, pc_string_length(s), c);
+    return found ? found - data + 1 : 0;
+}
+
+// 用首字符的向量化查找定位候选, 再比较其余部分
+int64_t pc_find(const pc_string *s, const pc_string *needle) {
+    const char *data = pc_string_data(s), *needleData = pc_string_data(needle);
+    size_t length = pc_string_length(s), needleLength = pc_string_length(needle);
+    if (needleLength == 0)
+        return 1;
+
+    size_t pos = 0;
+    while (pos + needleLength <= length) {
+        const char *found = findChar(data + pos, length - pos - needleLength + 1, needleData[0]);
+        if (!found)
+            return 0;
+        pos = found - data;
+        if (!memcmp(found + 1, needleData + 1, needleLength - 1))
+            return pos + 1;
+        pos++;
+    }
+    return 0;
+}